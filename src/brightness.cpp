@@ -1,28 +1,66 @@
 #include "brightness.h"
 
-#include <qregularexpression.h>
-#include <QDateTime>
+#include <qthread.h>
 
-#ifdef ENABLE_LOGIND
-# if defined(HAVE_LIBSYSTEMD)
-#  include <systemd/sd-bus.h>
-# elif defined(HAVE_LIBELOGIND)
-#  include <elogind/sd-bus.h>
-# elif defined(HAVE_BASU)
-#  include <basu/sd-bus.h>
-# else
-#  error "No dbus provider found"
-# endif
-#endif
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <utility>
 
 namespace hw_monitor
 {
-static const QRegularExpression regex("^/sys/class/([^/]+)/([^/]+)/brightness$");
-
 static constexpr auto basePath       = "/sys/class/";
 static constexpr auto backlightClass = "backlight";
 static constexpr auto ledClass       = "leds";
 
+// How long the attributes of a new trigger are retried while udev makes
+// them writable
+static constexpr int triggerSetupInterval = 25;
+static constexpr int triggerSetupAttempts = 40;
+
+// Triggers started by blink() and pattern(), they change brightness on their
+// own for as long as they run
+static bool isEffectTrigger(const QString& trigger)
+{
+    return trigger == "timer" || trigger == "pattern";
+}
+
+// Writes value at offset 0 of an attribute kept open in fd, opening it on
+// first use. A device that went away is reopened on the next write.
+static bool writeAttribute(int& fd, const QString& path, const QByteArray& value, QString& error)
+{
+    if (fd < 0)
+        fd = ::open(path.toLocal8Bit().constData(), O_WRONLY | O_CLOEXEC);
+
+    ssize_t n = -1;
+    if (fd >= 0)
+        do n = ::pwrite(fd, value.constData(), value.size(), 0); while (n < 0 && errno == EINTR);
+
+    if (n == value.size()) return true;
+
+    if (n >= 0)
+    {
+        error = QStringLiteral("Short write");
+        return false;
+    }
+
+    // Taken before anything else can overwrite it
+    const int code = errno;
+
+    error = QString::fromLocal8Bit(strerror(code));
+    if (fd >= 0 && (code == ENODEV || code == ENOENT || code == EBADF))
+    {
+        ::close(fd);
+        fd = -1;
+    }
+
+    return false;
+}
+
 BrightnessEntry::BrightnessEntry(
     QObject* parent,
     const Class clazz,
@@ -35,8 +73,26 @@ BrightnessEntry::BrightnessEntry(
 , _id(id)
 , _current(current)
 , _max(max)
+, _written(current)
 , _pathCurrent(path_current)
-{}
+{
+    _fade.timer.setSingleShot(true);
+    connect(&_fade.timer, &QTimer::timeout, this, &BrightnessEntry::fadeStep);
+
+    _effect.timer.setSingleShot(true);
+    connect(&_effect.timer, &QTimer::timeout, this, &BrightnessEntry::effectStep);
+
+    _setup.timer.setSingleShot(true);
+    connect(&_setup.timer, &QTimer::timeout, this, &BrightnessEntry::setupStep);
+}
+
+BrightnessEntry::~BrightnessEntry()
+{
+    if (_currentFd >= 0)
+        ::close(_currentFd);
+    if (_intensityFd >= 0)
+        ::close(_intensityFd);
+}
 
 int BrightnessEntry::current() const
 {
@@ -45,8 +101,8 @@ int BrightnessEntry::current() const
 
 void BrightnessEntry::current(const int value)
 {
-    _current = std::clamp(value, 0, _max);
-    requestSync();
+    interrupt();
+    set(std::clamp(value, 0, _max));
 }
 
 qreal BrightnessEntry::currentNormalized() const
@@ -56,8 +112,50 @@ qreal BrightnessEntry::currentNormalized() const
 
 void BrightnessEntry::currentNormalized(const qreal value)
 {
-    _current = static_cast<int>(std::clamp(value, 0.0, 1.0) * _max);
-    requestSync();
+    interrupt();
+    set(static_cast<int>(std::clamp(value, 0.0, 1.0) * _max));
+}
+
+bool BrightnessEntry::assign(const int value)
+{
+    // A pending write already carries it
+    if (value == _current) return false;
+
+    _current = value;
+    emit currentChanged();
+    return true;
+}
+
+bool BrightnessEntry::stage(const int value)
+{
+    // Removed, nothing is written anymore
+    if (!_owner) return false;
+
+    // Writing 0 makes the kernel drop the trigger. Setting the trigger left
+    // current at 0 already, so that 0 is written even though it's no change.
+    const bool dropsTrigger = value == 0 && _trigger != "none";
+
+    if (!assign(value) && !dropsTrigger) return false;
+
+    if (dropsTrigger)
+        _written = -1;
+
+    _owner->markDirty(this);
+
+    if (dropsTrigger)
+    {
+        _trigger = "none";
+        _owner->_notifier.suspend(classAsString(_class) + '/' + _id, false);
+        emit triggerChanged();
+    }
+
+    return true;
+}
+
+void BrightnessEntry::set(const int value)
+{
+    if (stage(value))
+        _owner->kick();
 }
 
 int BrightnessEntry::max() const
@@ -65,132 +163,604 @@ int BrightnessEntry::max() const
     return _max;
 }
 
-BrightnessEntry::Class BrightnessEntry::clazz() const
+void BrightnessEntry::interrupt()
 {
-    return _class;
+    _effect.timer.stop();
+    cancelSetup();
+    cancelFade();
 }
 
-const QString& BrightnessEntry::id() const
+void BrightnessEntry::fadeTo(const int target, const int duration, const int easing)
 {
-    return _id;
+    _effect.timer.stop();
+    fade(target, duration, easing);
 }
 
-const QString& BrightnessEntry::pathCurrent() const
+void BrightnessEntry::fade(const int target, const int duration, const int easing)
 {
-    return _pathCurrent;
+    if (!_owner) return;
+
+    const int to = std::clamp(target, 0, _max);
+
+    if (duration <= 0 || to == _current)
+    {
+        cancelFade();
+        set(to);
+        return;
+    }
+
+    const bool wasFading = fading();
+
+    _fade.from     = _current;
+    _fade.to       = to;
+    _fade.duration = duration;
+    _fade.easing   = QEasingCurve(static_cast<QEasingCurve::Type>(easing));
+    _fade.elapsed.start();
+
+    fadeStep();
+
+    if (!wasFading && fading())
+        emit fadingChanged();
 }
 
-QString BrightnessEntry::classAsString(const Class clazz)
+void BrightnessEntry::cancelFade()
 {
-    return clazz == Class::Backlight ? backlightClass : ledClass;
+    if (!fading()) return;
+
+    _fade.timer.stop();
+    emit fadingChanged();
+}
+
+bool BrightnessEntry::fading() const
+{
+    return _fade.timer.isActive();
 }
 
-void BrightnessEntry::requestSync()
+void BrightnessEntry::fadeStep()
 {
-    const auto now = QDateTime::currentMSecsSinceEpoch();
-    auto& [timeoutUntil, queuedValue, timer] = _sync;
+    const auto& [from, to, duration, easing, elapsed, timer] = _fade;
+
+    const qint64 now = elapsed.elapsed();
+    const int direction = to > from ? 1 : -1;
+    const auto rawAt = [&](const qreal progress)
+    {
+        return from + (to - from) * easing.valueForProgress(progress);
+    };
 
-    if (timer || now > timeoutUntil) // Can write now
+    if (now >= duration)
     {
-        writeChanges();
-        timeoutUntil = now + _updateDelay;
+        set(to);
+        emit fadingChanged();
+        return;
     }
 
-    else // Not ready yet
+    const qreal progress = static_cast<qreal>(now) / duration;
+    const int value = static_cast<int>(std::lround(rawAt(progress)));
+    if (value != _current)
+        set(value);
+
+    // Earliest progress at which the curve rounds to the next raw step,
+    // found by bisection as easing curves have no inverse
+    const qreal threshold = value + 0.5 * direction;
+    qreal low  = progress;
+    qreal high = 1.0;
+    for (int i = 0; i < 24; ++i)
     {
-        // Timer already running, just update the value it will apply
-        if (timer)
+        const qreal mid = (low + high) / 2;
+        if ((rawAt(mid) - threshold) * direction >= 0)
+            high = mid;
+        else
+            low = mid;
+    }
+
+    // Never faster than the writes go out
+    const qint64 next = std::max<qint64>(std::llround(high * duration) - now, _owner->updateDelay());
+    _fade.timer.start(static_cast<int>(std::max<qint64>(next, 1)));
+}
+
+QStringList BrightnessEntry::triggers() const
+{
+    return _triggers;
+}
+
+QString BrightnessEntry::trigger() const
+{
+    return _trigger;
+}
+
+void BrightnessEntry::trigger(const QString& trigger)
+{
+    if (!_owner || trigger == _trigger) return;
+
+    // Attributes of the previous trigger are gone with it
+    cancelSetup();
+
+    if (!_triggers.contains(trigger))
+    {
+        qWarning() << "LED" << _id << "has no trigger" << trigger;
+        return;
+    }
+
+    if (!writeLedAttribute("trigger", trigger.toLatin1())) return;
+
+    // Changing the trigger turns the LED off
+    _trigger = trigger;
+    _written = 0;
+    assign(0);
+
+    // A kernel effect changes brightness on its own, it is not polled
+    _owner->_notifier.suspend(classAsString(_class) + '/' + _id, isEffectTrigger(_trigger));
+
+    emit triggerChanged();
+}
+
+void BrightnessEntry::blink(const int delayOn, const int delayOff)
+{
+    interrupt();
+
+    // Jumps by zero length steps, brightness in between holds
+    const QList<int> steps { _max, delayOn, _max, 0, 0, delayOff, 0, 0 };
+
+    if (_triggers.contains("timer"))
+    {
+        trigger("timer");
+
+        if (_trigger == "timer")
         {
-            queuedValue = _current;
+            setupTrigger({
+                { "delay_on",  QByteArray::number(std::max(delayOn, 0)) },
+                { "delay_off", QByteArray::number(std::max(delayOff, 0)) },
+            }, [this, steps] { pattern(steps); });
             return;
         }
+    }
+
+    pattern(steps);
+}
 
-        timer = new QTimer(this);
-        timer->setSingleShot(true);
+void BrightnessEntry::pattern(const QList<int>& steps, const int repeat)
+{
+    interrupt();
 
-        connect(timer, &QTimer::timeout, this, [this]
+    if (steps.size() < 4 || steps.size() % 2 != 0)
+    {
+        qWarning() << "A pattern needs at least two brightness and duration pairs";
+        return;
+    }
+
+    // The kernel rejects it as well
+    if (repeat == 0)
+    {
+        qWarning() << "A pattern needs to repeat at least once, or forever if negative";
+        return;
+    }
+
+    QList<std::pair<int, int>> pairs;
+    QByteArray kernelPattern;
+
+    for (qsizetype i = 0; i < steps.size(); i += 2)
+    {
+        pairs.append({ std::clamp(steps[i], 0, _max), std::max(steps[i + 1], 0) });
+        kernelPattern += QByteArray::number(pairs.last().first) + ' ' + QByteArray::number(pairs.last().second) + ' ';
+    }
+    kernelPattern.chop(1);
+
+    // Nothing would ever hold, the fallback would spin
+    if (std::ranges::all_of(pairs, [](const auto& pair) { return pair.second == 0; }))
+    {
+        qWarning() << "A pattern needs at least one step with a duration";
+        return;
+    }
+
+    if (_triggers.contains("pattern"))
+    {
+        trigger("pattern");
+
+        if (_trigger == "pattern")
+        {
+            setupTrigger({
+                { "repeat",  QByteArray::number(repeat < 0 ? -1 : repeat) },
+                { "pattern", kernelPattern },
+            }, [this, pairs, repeat] { runEffect(pairs, repeat); });
+            return;
+        }
+    }
+
+    runEffect(pairs, repeat);
+}
+
+void BrightnessEntry::runEffect(const QList<std::pair<int, int>>& steps, const int repeat)
+{
+    // Leaves a kernel effect that failed half way
+    if (_trigger != "none")
+        trigger("none");
+
+    _effect.steps  = steps;
+    _effect.next   = 0;
+    _effect.repeat = repeat;
+    effectStep();
+}
+
+void BrightnessEntry::setupTrigger(const QList<std::pair<QByteArray, QByteArray>>& attributes, std::function<void()> fallback)
+{
+    cancelSetup();
+
+    _setup.attributes = attributes;
+    _setup.fallback   = std::move(fallback);
+    _setup.attempts   = 0;
+    setupStep();
+}
+
+void BrightnessEntry::setupStep()
+{
+    auto& [attributes, fallback, attempts, timer] = _setup;
+
+    // Only the last attempt reports, earlier ones may just be early
+    const bool last = ++attempts >= triggerSetupAttempts;
+
+    while (!attributes.isEmpty() && writeLedAttribute(attributes.first().first.constData(), attributes.first().second, last))
+        attributes.removeFirst();
+
+    if (attributes.isEmpty())
+    {
+        fallback = nullptr;
+        return;
+    }
+
+    if (!last)
+    {
+        timer.start(triggerSetupInterval);
+        return;
+    }
+
+    attributes.clear();
+    std::exchange(fallback, nullptr)();
+}
+
+void BrightnessEntry::cancelSetup()
+{
+    _setup.timer.stop();
+    _setup.attributes.clear();
+    _setup.fallback = nullptr;
+}
+
+void BrightnessEntry::stopEffect()
+{
+    interrupt();
+
+    if (isEffectTrigger(_trigger))
+        trigger("none");
+}
+
+void BrightnessEntry::effectStep()
+{
+    if (!_owner) return;
+
+    auto& [steps, next, repeat, timer] = _effect;
+
+    // Zero length steps are jumps, they run right away until a step holds.
+    // pattern() made sure one does.
+    for (;;)
+    {
+        // repeat counts the passes left including this one
+        if (next == steps.size())
         {
-            _current = _sync.queuedValue;
-            writeChanges();
-            _sync.timer->deleteLater();
-        });
+            if (repeat > 0 && --repeat == 0) return;
+            next = 0;
+        }
+
+        const auto [value, duration] = steps[next];
+        const int target = steps[(next + 1) % steps.size()].first;
+        ++next;
+
+        cancelFade();
+        set(value);
+
+        if (duration == 0) continue;
+
+        if (target != value)
+            fade(target, duration, QEasingCurve::Linear);
+
+        // Writes go out at most once per updateDelay anyway
+        timer.start(std::max(duration, _owner->_updateDelay));
+        return;
     }
 }
 
+bool BrightnessEntry::writeLedAttribute(const char* name, const QByteArray& value, const bool report)
+{
+    if (!_owner) return false;
+
+    int fd = -1;
+    const QString path = _pathCurrent.chopped(qsizetype(sizeof("brightness")) - 1) + name;
+
+    QString error;
+    const bool written = writeAttribute(fd, path, value, error);
+
+    if (fd >= 0)
+        ::close(fd);
+
+    if (!written && report)
+        emit _owner->writeFailed(_id, error);
+
+    return written;
+}
+
+QStringList BrightnessEntry::multiIndex() const
+{
+    return _multiIndex;
+}
+
+QList<int> BrightnessEntry::multiIntensity() const
+{
+    return _multiIntensity;
+}
+
+void BrightnessEntry::multiIntensity(const QList<int>& intensity)
+{
+    if (!_owner) return;
+
+    if (intensity.size() != _multiIntensity.size())
+    {
+        qWarning() << "Expected" << _multiIntensity.size() << "intensities for" << _id << "got" << intensity.size();
+        return;
+    }
+
+    QList<int> clamped(intensity.size());
+    std::ranges::transform(intensity, clamped.begin(), [this](const int value)
+    {
+        return std::clamp(value, 0, _max);
+    });
+
+    if (clamped == _multiIntensity) return;
+
+    _multiIntensity = std::move(clamped);
+    _owner->schedule(this);
+
+    emit multiIntensityChanged();
+}
+
+void BrightnessEntry::setColor(const QColor& color)
+{
+    QList<int> intensity = _multiIntensity;
+
+    for (qsizetype i = 0; i < _multiIndex.size(); ++i)
+    {
+        const QString& channel = _multiIndex[i];
+        const int component = channel == "red"   ? color.red()
+                            : channel == "green" ? color.green()
+                            : channel == "blue"  ? color.blue()
+                            : -1;
+
+        if (component >= 0)
+            intensity[i] = static_cast<int>(std::lround(component * _max / 255.0));
+    }
+
+    multiIntensity(intensity);
+}
+
+BrightnessEntry::Class BrightnessEntry::clazz() const
+{
+    return _class;
+}
+
+const QString& BrightnessEntry::id() const
+{
+    return _id;
+}
+
+const QString& BrightnessEntry::pathCurrent() const
+{
+    return _pathCurrent;
+}
+
+QString BrightnessEntry::classAsString(const Class clazz)
+{
+    return clazz == Class::Backlight ? backlightClass : ledClass;
+}
+
 void BrightnessEntry::writeChanges()
 {
+    _written = _current;
+
 #ifdef ENABLE_LOGIND
-    sd_bus* bus = nullptr;
-    int r = sd_bus_default_system(&bus);
-    if (r < 0)
-        qWarning() << "Can't connect to system bus:" << strerror(-r);
-
-    r = sd_bus_call_method(bus,
-                           "org.freedesktop.login1",
-                           "/org/freedesktop/login1/session/auto",
-                           "org.freedesktop.login1.Session",
-                           "SetBrightness",
-                           nullptr,
-                           nullptr,
-                           "ssu",
-                           classAsString(_class).toUtf8().constData(),
-                           _id.toUtf8().constData(),
-                           _current);
-
-    if (r < 0)
-        qWarning() << "Failed to set brightness: " << strerror(-r);
-
-    sd_bus_unref(bus);
+    // Returns right away, failures come back as Brightness::writeFailed
+    _owner->_bus.setBrightness(classAsString(_class), _id, _current);
 #else
-    if (QFile file(_pathCurrent); file.open(QIODevice::WriteOnly))
+    if (QString error; !writeAttribute(_currentFd, _pathCurrent, QByteArray::number(_current), error))
+        emit _owner->writeFailed(_id, error);
+#endif
+}
+
+void BrightnessEntry::writeIntensity()
+{
+    _writtenIntensity = _multiIntensity;
+
+    QByteArray value;
+    for (const int intensity : _multiIntensity)
+        value += QByteArray::number(intensity) + ' ';
+    value.chop(1);
+
+    // logind only sets brightness, the channels are written directly
+    const QString path = _pathCurrent.chopped(qsizetype(sizeof("brightness")) - 1) + "multi_intensity";
+
+    if (QString error; !writeAttribute(_intensityFd, path, value, error))
+        emit _owner->writeFailed(_id, error);
+}
+
+
+Brightness::Brightness(QObject* parent, const QString& root)
+: QObject(parent)
+, _root(root)
+, _notifier(root)
+{
+    _flushTimer.setInterval(_updateDelay);
+    connect(&_flushTimer, &QTimer::timeout, this, &Brightness::flush);
+
+#ifdef ENABLE_LOGIND
+    connect(&_bus, &LogindBus::failed, this, [this](const QString&, const QString& id, const QString& error)
+    {
+        emit writeFailed(id, error);
+    });
+#endif
+
+    connect(&_notifier, &BrightnessNotifier::changed, this, &Brightness::deviceChanged);
+    connect(&_notifier, &BrightnessNotifier::deviceAdded, this, &Brightness::deviceAdded);
+    connect(&_notifier, &BrightnessNotifier::deviceRemoved, this, &Brightness::deviceRemoved);
+
+    // Sysfs reads can stall on slow drivers, the engine doesn't wait for them
+    discover(BrightnessEntry::Class::Backlight);
+}
+
+Brightness::~Brightness()
+{
+    // Their results are dropped with this object, the reads are not
+    for (const auto thread : findChildren<QThread*>(Qt::FindDirectChildrenOnly))
+        thread->wait();
+}
+
+bool Brightness::ready() const
+{
+    return _ready;
+}
+
+void Brightness::discover(const BrightnessEntry::Class clazz)
+{
+    QThread* thread = QThread::create([this, clazz, root = _root]
+    {
+        QMetaObject::invokeMethod(this, [this, clazz, devices = readClass(root, clazz)]
+        {
+            install(clazz, devices);
+        }, Qt::QueuedConnection);
+    });
+
+    thread->setObjectName("BrightnessDiscovery");
+    thread->setParent(this);
+    connect(thread, &QThread::finished, thread, &QObject::deleteLater);
+    thread->start();
+}
+
+void Brightness::install(const BrightnessEntry::Class clazz, const QList<Device>& devices)
+{
+    auto& list = clazz == BrightnessEntry::Class::Backlight ? _backlights : _leds;
+
+    for (const auto& device : devices)
     {
-        file.write(QByteArray::number(_current));
-        file.flush();
-        file.close();
+        const QString path = BrightnessEntry::classAsString(clazz) + '/' + device.id;
+
+        // Hotplug may have been quicker
+        if (_entries.contains(path)) continue;
+
+        BrightnessEntry* entry = createEntry(device);
+
+        _entries.insert(path, entry);
+        _notifier.add(path, entry->current());
+        _notifier.suspend(path, isEffectTrigger(entry->trigger()));
+        list.append(entry);
     }
 
+    if (clazz == BrightnessEntry::Class::Backlight)
+    {
+        emit backlightsChanged();
+        updatePrimary();
+
+        _ready = true;
+        emit readyChanged();
+    }
     else
-        qWarning() << "Failed to set brightness: " << file.errorString();
-#endif
+    {
+        _ledsInstalled = true;
+        emit ledsChanged();
+    }
+
+    // Values set while these were read
+    if (applyPending())
+        kick();
 }
 
+void Brightness::requestLeds()
+{
+    if (_ledsRequested) return;
+    _ledsRequested = true;
 
-Brightness::Brightness(QObject* parent)
-: QObject(parent)
-, _backlights(parseClass(this, BrightnessEntry::Class::Backlight))
-, _leds(parseClass(this, BrightnessEntry::Class::Led))
+    discover(BrightnessEntry::Class::Led);
+}
+
+void Brightness::deviceChanged(const QString& path, const int value)
 {
-    for (const auto& entry : _backlights)
-        _watcher.addPath(entry->pathCurrent());
-    for (const auto& entry : _leds)
-        _watcher.addPath(entry->pathCurrent());
+    BrightnessEntry* entry = _entries.value(path);
+    if (!entry) return;
 
-    connect(&_watcher, &QFileSystemWatcher::fileChanged, this, [this](const QString& path)
+    // Pending writes and fades still go out, they are newer
+    entry->_written = value;
+    if (!entry->_dirty && !entry->fading() && entry->_current != value)
     {
-        if (QFile f(path); f.open(QIODevice::ReadOnly))
-        {
-            const int newVal = f.readAll().trimmed().toInt();
-            f.close();
+        entry->_current = value;
+        emit entry->currentChanged();
+    }
+}
 
-            if (const QRegularExpressionMatch match = regex.match(path); match.hasMatch())
-            {
-                const QString className  = match.captured(1);  // backlight or leds
-                const QString id         = match.captured(2);  // intel_backlight, etc.
+void Brightness::deviceAdded(const QString& path)
+{
+    if (_entries.contains(path)) return;
 
-                if (className != backlightClass && className != ledClass) return;
+    const qsizetype slash = path.indexOf('/');
+    const QString className = path.left(slash);
+    const auto clazz = className == backlightClass ? BrightnessEntry::Class::Backlight : BrightnessEntry::Class::Led;
 
-                QList<BrightnessEntry*> entries = className == backlightClass ? _backlights : _leds;
-                for (const auto& backlight : entries)
-                    if (backlight->id() == id)
-                        backlight->_current = newVal;
-            }
-        }
+    // Not read yet, discovery will find it
+    if (clazz == BrightnessEntry::Class::Led && !_ledsRequested) return;
 
-        /// As a safety measure, many applications save an open
-            /// file by writing a new file and then deleting the old one.
-            /// So if it's missing add it back
-        _watcher.addPath(path);
-    });
+    // Only this device is read, the class directories are not scanned again
+    const auto device = readDevice(_root, clazz, path.mid(slash + 1));
+    if (!device) return;
+
+    BrightnessEntry* entry = createEntry(*device);
+
+    _entries.insert(path, entry);
+    _notifier.add(path, entry->current());
+    _notifier.suspend(path, isEffectTrigger(entry->trigger()));
+
+    if (clazz == BrightnessEntry::Class::Backlight)
+    {
+        _backlights.append(entry);
+        emit backlightsChanged();
+        updatePrimary();
+    }
+    else
+    {
+        _leds.append(entry);
+        emit ledsChanged();
+    }
+}
+
+void Brightness::deviceRemoved(const QString& path)
+{
+    BrightnessEntry* entry = _entries.take(path);
+    if (!entry) return;
+
+    _notifier.remove(path);
+    _dirty.removeOne(entry);
+    entry->interrupt();
+
+    // Cut loose, writes QML still sends to it are dropped
+    entry->_dirty = false;
+    entry->_owner = nullptr;
+
+    if (entry->clazz() == BrightnessEntry::Class::Backlight)
+    {
+        _backlights.removeOne(entry);
+        emit backlightsChanged();
+        updatePrimary();
+    }
+    else
+    {
+        _leds.removeOne(entry);
+        emit ledsChanged();
+    }
+
+    // QML may still hold it until the lists are re-read
+    entry->deleteLater();
 }
 
 int Brightness::updateDelay() const
@@ -200,69 +770,235 @@ int Brightness::updateDelay() const
 
 void Brightness::updateDelay(const int value)
 {
-    _updateDelay = value;
+    _updateDelay = std::max(value, 0);
+    _flushTimer.setInterval(_updateDelay);
+}
 
-    for (const auto backlight : _backlights)
-        backlight->_updateDelay = value;
+qint64 Brightness::writesIssued() const
+{
+    return _writesIssued;
+}
 
-    for (const auto backlight : _leds)
-        backlight->_updateDelay = value;
+qint64 Brightness::writesCoalesced() const
+{
+    return _writesCoalesced;
 }
 
-// Backlight defaults
-int Brightness::backlight() const
+void Brightness::markDirty(BrightnessEntry* entry)
 {
-    if (_backlights.empty())
+    if (entry->_dirty)
+        ++_writesCoalesced; // replaces the value still waiting
+    else
     {
-        qWarning() << "No Backlights found on system";
-        return 0;
+        entry->_dirty = true;
+        _dirty.append(entry);
     }
+}
 
-    return _backlights.first()->current();
+void Brightness::kick()
+{
+    // Idle, the first value goes out right away and opens an interval
+    if (!_flushTimer.isActive())
+    {
+        flush();
+        _flushTimer.start();
+    }
 }
 
-void Brightness::backlight(const int value)
+void Brightness::schedule(BrightnessEntry* entry)
 {
-    if (_backlights.empty())
+    markDirty(entry);
+    kick();
+}
+
+BrightnessEntry* Brightness::find(const QString& id) const
+{
+    if (BrightnessEntry* entry = _entries.value(id))
+        return entry;
+
+    for (const auto& entry : _backlights + _leds)
+        if (entry->id() == id)
+            return entry;
+
+    return nullptr;
+}
+
+void Brightness::apply(BrightnessEntry* entry, const qreal value, const bool normalized)
+{
+    const int raw = normalized ? static_cast<int>(std::clamp(value, 0.0, 1.0) * entry->max())
+                               : std::clamp(static_cast<int>(value), 0, entry->max());
+
+    entry->interrupt();
+    entry->stage(raw);
+}
+
+void Brightness::applyOrHold(const QString& id, const qreal value, const bool normalized)
+{
+    if (BrightnessEntry* entry = find(id))
     {
-        qWarning() << "No Backlights found on system";
+        apply(entry, value, normalized);
         return;
     }
 
-    _backlights.first()->current(value);
+    // Its class is still being read, the latest value is kept for install()
+    if (!_ready || !_ledsInstalled)
+    {
+        _pending.insert(id, { value, normalized });
+        return;
+    }
+
+    qWarning() << "No brightness device" << id;
 }
 
-qreal Brightness::backlightNormalized() const
+bool Brightness::applyPending()
 {
-    if (_backlights.empty())
+    bool applied = false;
+
+    for (auto it = _pending.begin(); it != _pending.end();)
     {
-        qWarning() << "No Backlights found on system";
-        return 0;
+        if (BrightnessEntry* entry = find(it.key()))
+        {
+            apply(entry, it->value, it->normalized);
+            applied = true;
+            it = _pending.erase(it);
+        }
+        else
+            ++it;
     }
 
-    return _backlights.first()->currentNormalized();
+    // Every class was read, the rest names nothing
+    if (_ready && _ledsInstalled)
+        for (const auto& id : std::exchange(_pending, {}).keys())
+            qWarning() << "No brightness device" << id;
+
+    return applied;
 }
 
-void Brightness::backlightNormalized(const qreal value)
+void Brightness::setMany(const QVariantMap& values)
 {
-    if (_backlights.empty())
+    requestLeds();
+
+    for (const auto& [id, value] : values.asKeyValueRange())
+        applyOrHold(id, value.toInt(), false);
+
+    kick();
+}
+
+void Brightness::defineGroup(const QString& name, const QStringList& ids)
+{
+    requestLeds();
+    _groups.insert(name, ids);
+}
+
+void Brightness::setGroupNormalized(const QString& name, const qreal value)
+{
+    const auto it = _groups.constFind(name);
+    if (it == _groups.cend())
     {
-        qWarning() << "No Backlights found on system";
+        qWarning() << "No brightness group" << name;
         return;
     }
 
-    return _backlights.first()->currentNormalized(value);
+    for (const auto& id : *it)
+        applyOrHold(id, value, true);
+
+    kick();
 }
 
-int Brightness::backlightMax() const
+void Brightness::flush()
+{
+    // Nothing set during the interval, the next value may write right away
+    if (_dirty.isEmpty())
+    {
+        _flushTimer.stop();
+        return;
+    }
+
+    // Sent back to back, over the bus none of them waits for a reply
+    for (const auto entry : std::exchange(_dirty, {}))
+    {
+        entry->_dirty = false;
+
+        const bool brightness = entry->_current != entry->_written;
+        const bool intensity  = entry->_multiIntensity != entry->_writtenIntensity;
+
+        if (!brightness && !intensity)
+            ++_writesCoalesced;
+
+        if (brightness)
+        {
+            entry->writeChanges();
+            ++_writesIssued;
+        }
+
+        if (intensity)
+        {
+            entry->writeIntensity();
+            ++_writesIssued;
+        }
+    }
+
+    emit writeStatsChanged();
+}
+
+// Backlight defaults
+BrightnessEntry* Brightness::primaryBacklight() const
 {
     if (_backlights.empty())
     {
-        qWarning() << "No Backlights found on system";
-        return 0;
+        // Before that there is nothing to warn about yet
+        if (_ready)
+            qWarning() << "No Backlights found on system";
+        return nullptr;
     }
 
-    return _backlights.first()->max();
+    return _backlights.first();
+}
+
+void Brightness::updatePrimary()
+{
+    BrightnessEntry* primary = _backlights.isEmpty() ? nullptr : _backlights.first();
+    if (primary == _primary) return;
+
+    if (_primary)
+        disconnect(_primary, &BrightnessEntry::currentChanged, this, &Brightness::backlightChanged);
+
+    _primary = primary;
+
+    if (_primary)
+        connect(_primary, &BrightnessEntry::currentChanged, this, &Brightness::backlightChanged);
+
+    emit backlightChanged();
+}
+
+int Brightness::backlight() const
+{
+    const auto entry = primaryBacklight();
+    return entry ? entry->current() : 0;
+}
+
+void Brightness::backlight(const int value)
+{
+    if (const auto entry = primaryBacklight())
+        entry->current(value);
+}
+
+qreal Brightness::backlightNormalized() const
+{
+    const auto entry = primaryBacklight();
+    return entry ? entry->currentNormalized() : 0;
+}
+
+void Brightness::backlightNormalized(const qreal value)
+{
+    if (const auto entry = primaryBacklight())
+        entry->currentNormalized(value);
+}
+
+int Brightness::backlightMax() const
+{
+    const auto entry = primaryBacklight();
+    return entry ? entry->max() : 0;
 }
 
 QList<BrightnessEntry*> Brightness::backlights()
@@ -272,52 +1008,101 @@ QList<BrightnessEntry*> Brightness::backlights()
 
 QList<BrightnessEntry*> Brightness::leds()
 {
+    // Most shells never look at them, they are read on first use
+    requestLeds();
     return _leds;
 }
 
-QList<BrightnessEntry*> Brightness::parseClass(Brightness* thiz, const BrightnessEntry::Class clazz)
+QList<Brightness::Device> Brightness::readClass(const QString& root, const BrightnessEntry::Class clazz)
 {
-    QList<BrightnessEntry*> controllers;
+    QList<Device> devices;
 
-    const QString classStr = BrightnessEntry::classAsString(clazz);
+    const QDir dir(root + basePath + BrightnessEntry::classAsString(clazz));
 
-    const QDir dir(basePath + classStr);
+    for (const QString& id : dir.entryList(QDir::Dirs | QDir::NoDotAndDotDot))
+        if (auto device = readDevice(root, clazz, id))
+            devices.push_back(std::move(*device));
 
-    for (const QFileInfo& fileInfo : dir.entryInfoList(QDir::Dirs | QDir::NoDotAndDotDot))
-    {
-        QString pathB = fileInfo.absoluteFilePath() + "/brightness";
-        QString pathM = fileInfo.absoluteFilePath() + "/max_brightness";
+    return devices;
+}
 
-        QFile fBrightness(pathB);
-        QFile fBrightnessMax(pathM);
+std::optional<Brightness::Device> Brightness::readDevice(
+    const QString& root,
+    const BrightnessEntry::Class clazz,
+    const QString& id)
+{
+    const QString path = root + basePath + BrightnessEntry::classAsString(clazz) + '/' + id;
 
-        if (!fBrightness.open(QIODevice::ReadOnly))
-            continue;
+    QFile fBrightness(path + "/brightness");
+    QFile fBrightnessMax(path + "/max_brightness");
 
-        QByteArray currentData = fBrightness.readAll();
-        fBrightness.close();
+    if (!fBrightness.open(QIODevice::ReadOnly))
+        return std::nullopt;
 
-        if (!fBrightnessMax.open(QIODevice::ReadOnly))
-            continue;
+    QByteArray currentData = fBrightness.readAll();
+    fBrightness.close();
 
-        QByteArray maxData = fBrightnessMax.readAll();
-        fBrightnessMax.close();
+    if (!fBrightnessMax.open(QIODevice::ReadOnly))
+        return std::nullopt;
 
-        const auto id = fileInfo.fileName();
+    QByteArray maxData = fBrightnessMax.readAll();
+    fBrightnessMax.close();
 
-        // Qt Manages lifetime so *should* not be a memory leak
-        // ReSharper disable once CppDFAMemoryLeak
-        const auto entry = new BrightnessEntry(
-            thiz,
-            clazz,
-            id,
-            currentData.trimmed().toInt(),
-            maxData.trimmed().toInt(),
-        pathB);
+    Device device {
+        .clazz   = clazz,
+        .id      = id,
+        .current = currentData.trimmed().toInt(),
+        .max     = maxData.trimmed().toInt(),
+    };
 
-        controllers.push_back(entry);
+    // Multicolor LEDs, "red green blue" and "255 128 0"
+    if (QFile fIndex(path + "/multi_index"), fIntensity(path + "/multi_intensity");
+        fIndex.open(QIODevice::ReadOnly) && fIntensity.open(QIODevice::ReadOnly))
+    {
+        device.multiIndex = QString::fromLatin1(fIndex.readAll().simplified()).split(' ', Qt::SkipEmptyParts);
+
+        for (const auto& intensity : fIntensity.readAll().simplified().split(' '))
+            device.multiIntensity.append(intensity.toInt());
+
+        if (device.multiIntensity.size() != device.multiIndex.size())
+        {
+            device.multiIndex.clear();
+            device.multiIntensity.clear();
+        }
     }
 
-    return controllers;
+    // "none rfkill0 [timer] pattern", the active one in brackets
+    if (QFile fTrigger(path + "/trigger"); fTrigger.open(QIODevice::ReadOnly))
+        for (const auto& name : fTrigger.readAll().simplified().split(' '))
+        {
+            const bool active = name.startsWith('[') && name.endsWith(']');
+            device.triggers.append(QString::fromLatin1(active ? name.mid(1, name.size() - 2) : name));
+
+            if (active)
+                device.trigger = device.triggers.last();
+        }
+
+    return device;
+}
+
+BrightnessEntry* Brightness::createEntry(const Device& device)
+{
+    // Qt Manages lifetime so *should* not be a memory leak
+    // ReSharper disable once CppDFAMemoryLeak
+    const auto entry = new BrightnessEntry(
+        this,
+        device.clazz,
+        device.id,
+        device.current,
+        device.max,
+        _root + basePath + BrightnessEntry::classAsString(device.clazz) + '/' + device.id + "/brightness");
+
+    entry->_owner            = this;
+    entry->_triggers         = device.triggers;
+    entry->_trigger          = device.trigger;
+    entry->_multiIndex       = device.multiIndex;
+    entry->_multiIntensity   = device.multiIntensity;
+    entry->_writtenIntensity = device.multiIntensity;
+    return entry;
 }
 }
\ No newline at end of file
@@ -4,21 +4,40 @@
 #include <qfile.h>
 #include <qurl.h>
 #include <qdir.h>
-#include <qfilesystemwatcher.h>
 #include <qqmlintegration.h>
 #include <qiodevice.h>
 #include <qtimer.h>
+#include <qelapsedtimer.h>
+#include <qeasingcurve.h>
+#include <qcolor.h>
+#include <qvariant.h>
 #include <QAbstractItemModel>
 
+#include <functional>
+#include <optional>
+
+#include "brightness_notifier.h"
+#include "logind_bus.h"
+#include "util/fs_root.h"
+
 namespace hw_monitor {
 
+class Brightness;
+
 class BrightnessEntry : public QObject
 {
     Q_OBJECT;
 
-    Q_PROPERTY(qreal current           READ current           WRITE current);
-    Q_PROPERTY(qreal currentNormalized READ currentNormalized WRITE currentNormalized);
+    Q_PROPERTY(qreal current           READ current           WRITE current           NOTIFY currentChanged);
+    Q_PROPERTY(qreal currentNormalized READ currentNormalized WRITE currentNormalized NOTIFY currentChanged);
     Q_PROPERTY(qreal max               READ max);
+    Q_PROPERTY(bool fading             READ fading            NOTIFY fadingChanged);
+
+    Q_PROPERTY(QStringList triggers      READ triggers       CONSTANT);
+    Q_PROPERTY(QString trigger           READ trigger        WRITE trigger        NOTIFY triggerChanged);
+
+    Q_PROPERTY(QStringList multiIndex    READ multiIndex     CONSTANT);
+    Q_PROPERTY(QList<int> multiIntensity READ multiIntensity WRITE multiIntensity NOTIFY multiIntensityChanged);
 
     Q_PROPERTY(QString id              READ id);
 
@@ -43,6 +62,7 @@ public:
         int current,
         int max,
         const QString& path_current);
+    ~BrightnessEntry() override;
 
     // Backlight defaults
     [[nodiscard]] int current() const;
@@ -53,19 +73,62 @@ public:
 
     [[nodiscard]] int max() const;
 
+    // Moves to target (raw, 0 to max) over duration ms along easing, an
+    // Easing.Type from QtQuick. Writes once per raw step the device can
+    // represent, at most once per updateDelay, instead of once per frame.
+    // Setting current cancels the fade, a new fade starts where this one is.
+    Q_INVOKABLE void fadeTo(int target, int duration, int easing = QEasingCurve::InOutQuad);
+    Q_INVOKABLE void cancelFade();
+    [[nodiscard]] bool fading() const;
+
+    // LED triggers the kernel offers, e.g. "none", "timer", "pattern"
+    [[nodiscard]] QStringList triggers() const;
+
+    // Active LED trigger, "none" leaves the LED to current
+    [[nodiscard]] QString trigger() const;
+    void trigger(const QString& trigger);
+
+    // Blinks on for delayOn and off for delayOff ms. Runs in the kernel
+    // through the timer trigger, without a single write from here while it
+    // runs. Falls back to a timer here where the trigger is unavailable.
+    Q_INVOKABLE void blink(int delayOn, int delayOff);
+
+    // Brightness and duration pairs, brightness moves linearly from one to
+    // the next over the duration, a duration of 0 jumps. Plays the pattern
+    // repeat times, forever if negative, like the kernel 0 is refused. Runs
+    // in the kernel through the pattern trigger, falls back like blink().
+    Q_INVOKABLE void pattern(const QList<int>& steps, int repeat = -1);
+
+    // Ends blink() and pattern(). Setting current ends the fallback ones,
+    // the kernel stops blinking once current is set to 0.
+    Q_INVOKABLE void stopEffect();
+
+    // Channels of a multicolor LED, e.g. "red", "green", "blue". Empty for
+    // single color devices.
+    [[nodiscard]] QStringList multiIndex() const;
+
+    // Intensity of every channel, 0 to max. The whole set is one write.
+    [[nodiscard]] QList<int> multiIntensity() const;
+    void multiIntensity(const QList<int>& intensity);
+
+    // Sets the red, green and blue channels from color, others keep theirs
+    Q_INVOKABLE void setColor(const QColor& color);
+
     Class clazz() const;
     const QString& id() const;
     const QString& pathCurrent() const;
 
     static QString classAsString(Class clazz);
 
+signals:
+    void currentChanged();
+    void fadingChanged();
+    void multiIntensityChanged();
+    void triggerChanged();
+
 private:
-    struct Sync
-    {
-        qsizetype timeoutUntil = 0;
-        int queuedValue = 0;
-        QTimer* timer = nullptr;
-    } _sync;
+    // nullptr once the device was removed
+    Brightness* _owner = nullptr;
 
     Class _class;
     Id_t _id;
@@ -73,37 +136,127 @@ private:
     int _current;
     int _max;
 
+    // Last value written or read back from the device
+    int _written;
+    // Waiting for the next flush of the owner
+    bool _dirty = false;
+
     QString _pathCurrent;
 
-    int _updateDelay = 50;
+    QStringList _triggers;
+    QString _trigger = "none";
+
+    // Attributes of a trigger that was just set. They appear with the
+    // trigger, owned by root, until udev ran the rules that open them up,
+    // so they are retried for a while before falling back.
+    struct TriggerSetup
+    {
+        QList<std::pair<QByteArray, QByteArray>> attributes; // name, value
+        std::function<void()> fallback;
+        int attempts = 0;
+        QTimer timer;
+    } _setup;
+
+    // Fallback of blink() and pattern() where the kernel can't run them
+    struct Effect
+    {
+        QList<std::pair<int, int>> steps; // brightness, duration
+        qsizetype next = 0;
+        int repeat     = 0;
+        QTimer timer;
+    } _effect;
 
-    void requestSync();
+    QStringList _multiIndex;
+    QList<int> _multiIntensity;
+    QList<int> _writtenIntensity;
+
+    // Kept open between writes, -1 until the first
+    int _currentFd   = -1;
+    int _intensityFd = -1;
+
+    struct Fade
+    {
+        int from = 0;
+        int to   = 0;
+        int duration = 0;
+        QEasingCurve easing;
+        QElapsedTimer elapsed;
+        QTimer timer;
+    } _fade;
+
+    // Sets the value without scheduling it, returns whether it changed
+    bool assign(int value);
+    // Sets the value for the next flush of the owner without starting it,
+    // returns whether it changed
+    bool stage(int value);
+    void set(int value);
+
+    // Stops fades and fallback effects ahead of a manual set
+    void interrupt();
+
+    void fade(int target, int duration, int easing);
+    void fadeStep();
+
+    // Writes an attribute of the device directory, e.g. "delay_on".
+    // Failures are reported through writeFailed if report is set.
+    bool writeLedAttribute(const char* name, const QByteArray& value, bool report = true);
+
+    // Writes attributes of the active trigger, calls fallback if they stay
+    // unwritable
+    void setupTrigger(const QList<std::pair<QByteArray, QByteArray>>& attributes, std::function<void()> fallback);
+    void setupStep();
+    void cancelSetup();
+
+    // Runs steps here, the kernel left out
+    void runEffect(const QList<std::pair<int, int>>& steps, int repeat);
+    void effectStep();
 
     void writeChanges();
+    void writeIntensity();
 };
 
 class Brightness : public QObject
 {
     Q_OBJECT;
 
+    Q_PROPERTY(bool ready      READ ready       NOTIFY readyChanged)
     Q_PROPERTY(int updateDelay READ updateDelay WRITE updateDelay)
 
-    Q_PROPERTY(qreal backlight           READ backlight           WRITE backlight)
-    Q_PROPERTY(qreal backlightNormalized READ backlightNormalized WRITE backlightNormalized)
-    Q_PROPERTY(qreal backlightMax        READ backlightMax)
+    Q_PROPERTY(qint64 writesIssued    READ writesIssued    NOTIFY writeStatsChanged)
+    Q_PROPERTY(qint64 writesCoalesced READ writesCoalesced NOTIFY writeStatsChanged)
 
-    Q_PROPERTY(QList<BrightnessEntry*> backlights READ backlights)
-    Q_PROPERTY(QList<BrightnessEntry*> leds       READ leds)
+    Q_PROPERTY(qreal backlight           READ backlight           WRITE backlight           NOTIFY backlightChanged)
+    Q_PROPERTY(qreal backlightNormalized READ backlightNormalized WRITE backlightNormalized NOTIFY backlightChanged)
+    Q_PROPERTY(qreal backlightMax        READ backlightMax                                 NOTIFY backlightChanged)
+
+    Q_PROPERTY(QList<BrightnessEntry*> backlights READ backlights NOTIFY backlightsChanged)
+    Q_PROPERTY(QList<BrightnessEntry*> leds       READ leds       NOTIFY ledsChanged)
 
     QML_SINGLETON
     QML_NAMED_ELEMENT(BrightnessController);
 
+    friend class BrightnessEntry;
+
 public:
-    explicit Brightness(QObject* parent = nullptr);
+    // root is prepended to every sysfs path, see defaultFsRoot(). Returns
+    // right away, devices are read on a thread of their own.
+    explicit Brightness(QObject* parent = nullptr, const QString& root = defaultFsRoot());
+    ~Brightness() override;
+
+    // The backlights were read. LEDs are only read once leds is first asked
+    // for and announce themselves through ledsChanged.
+    [[nodiscard]] bool ready() const;
 
+    // Minimum interval between two writes to a device. Values set in
+    // between replace each other, only the latest is written.
     [[nodiscard]] int updateDelay() const;
     void updateDelay(int value);
 
+    // Writes sent to a device, and values that were replaced before their
+    // write or skipped for matching what the device already had
+    [[nodiscard]] qint64 writesIssued() const;
+    [[nodiscard]] qint64 writesCoalesced() const;
+
     [[nodiscard]] int backlight() const;
     void backlight(int value);
 
@@ -115,11 +268,124 @@ public:
     [[nodiscard]] QList<BrightnessEntry*> backlights();
     [[nodiscard]] QList<BrightnessEntry*> leds();
 
+    // Sets many devices at once, { id: value } with raw values. Ids may be
+    // given as "leds/<id>" where a backlight and a LED share one. All
+    // writes go out in the same flush. Values for devices that are still
+    // being read are held and go out once they are.
+    Q_INVOKABLE void setMany(const QVariantMap& values);
+
+    // Names a set of devices so they can be set together
+    Q_INVOKABLE void defineGroup(const QString& name, const QStringList& ids);
+    Q_INVOKABLE void setGroupNormalized(const QString& name, qreal value);
+
+signals:
+    void readyChanged();
+
+    // A write to the device with id failed, through logind or sysfs
+    void writeFailed(const QString& id, const QString& error);
+
+    void writeStatsChanged();
+
+    // The primary backlight changed its brightness, or another one became
+    // primary, e.g. once discovery found the first
+    void backlightChanged();
+
+    // Devices came or went, e.g. a dock, a keyboard or a reloaded driver
+    void backlightsChanged();
+    void ledsChanged();
+
 private:
-    static QList<BrightnessEntry*> parseClass(Brightness* thiz, BrightnessEntry::Class clazz);
+    // What discovery read of a device, plain data so it can cross threads
+    struct Device
+    {
+        BrightnessEntry::Class clazz;
+        QString id;
+        int current = 0;
+        int max     = 0;
+
+        QStringList triggers;
+        QString trigger = "none";
+
+        QStringList multiIndex;
+        QList<int> multiIntensity;
+    };
+
+    // Safe to call from any thread
+    static QList<Device> readClass(const QString& root, BrightnessEntry::Class clazz);
+    // Reads the device id of clazz, nothing if it has no usable brightness
+    static std::optional<Device> readDevice(const QString& root, BrightnessEntry::Class clazz, const QString& id);
+
+    [[nodiscard]] BrightnessEntry* createEntry(const Device& device);
+
+    // Reads clazz on a new thread, install() takes the result on this one
+    void discover(BrightnessEntry::Class clazz);
+    void install(BrightnessEntry::Class clazz, const QList<Device>& devices);
+    // Starts reading the LEDs, once
+    void requestLeds();
+
+    // The first backlight, nullptr with a warning once ready and none exists
+    [[nodiscard]] BrightnessEntry* primaryBacklight() const;
+
+    // The entry backlightChanged follows, the first of _backlights
+    BrightnessEntry* _primary = nullptr;
+    // Follows the first of _backlights after the list changed
+    void updatePrimary();
+
+    QString _root;
+
+    bool _ready         = false;
+    bool _ledsRequested = false;
 
     int _updateDelay = 50;
-    QFileSystemWatcher _watcher;
+
+    // Changes made by anyone else, dispatched through _entries
+    BrightnessNotifier _notifier;
+    QHash<QString, BrightnessEntry*> _entries; // by path below /sys/class
+
+    void deviceChanged(const QString& path, int value);
+    void deviceAdded(const QString& path);
+    void deviceRemoved(const QString& path);
+
+    // Latest value wins: set values mark their entry dirty, one timer
+    // flushes every dirty entry at most once per updateDelay
+    QTimer _flushTimer;
+    QList<BrightnessEntry*> _dirty;
+
+    qint64 _writesIssued    = 0;
+    qint64 _writesCoalesced = 0;
+
+    QHash<QString, QStringList> _groups;
+
+    // Values set for ids before discovery read their class, install()
+    // applies them. Raw values, or between 0 and 1 from groups.
+    struct Pending
+    {
+        qreal value     = 0;
+        bool normalized = false;
+    };
+    QHash<QString, Pending> _pending;
+    bool _ledsInstalled = false;
+
+    // Marks entry for the next flush with value, raw or normalized
+    void apply(BrightnessEntry* entry, qreal value, bool normalized);
+    // Applies value to id, or holds it while its device may still be read
+    void applyOrHold(const QString& id, qreal value, bool normalized);
+    // Applies what was held for devices read since, returns whether any was
+    bool applyPending();
+
+    // Marks entry for the next flush
+    void markDirty(BrightnessEntry* entry);
+    // Flushes right away unless an interval is running
+    void kick();
+    void schedule(BrightnessEntry* entry);
+    void flush();
+
+    [[nodiscard]] BrightnessEntry* find(const QString& id) const;
+
+#ifdef ENABLE_LOGIND
+    // One connection for every write, opened with the controller
+    LogindBus _bus;
+#endif
 
     QList<BrightnessEntry*> _backlights;
     QList<BrightnessEntry*> _leds;
@@ -0,0 +1,260 @@
+#include "brightness_notifier.h"
+
+#include <qdebug.h>
+
+#include <linux/netlink.h>
+#include <sys/socket.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <vector>
+
+namespace hw_monitor
+{
+static constexpr auto classPrefix     = "/sys/class/";
+static constexpr int  minPollInterval = 250;
+static constexpr int  maxPollInterval = 8000;
+
+// Kernel uevents, as opposed to the ones udevd rebroadcasts after its rules ran
+static constexpr quint32 kernelUeventGroup = 1;
+
+BrightnessNotifier::BrightnessNotifier(const QString& root, QObject* parent)
+: QObject(parent)
+, _sources(root)
+{
+    _poll.setSingleShot(true);
+    _poll.setInterval(minPollInterval);
+    connect(&_poll, &QTimer::timeout, this, &BrightnessNotifier::poll);
+
+    if (root.isEmpty())
+        openNetlink();
+}
+
+BrightnessNotifier::~BrightnessNotifier()
+{
+    for (auto& [path, device] : _devices)
+    {
+        device.hwChanged.reset();
+        if (device.hwChangedFd >= 0)
+            ::close(device.hwChangedFd);
+    }
+
+    _netlink.reset();
+    if (_netlinkFd >= 0)
+        ::close(_netlinkFd);
+}
+
+void BrightnessNotifier::add(const QString& path, const int value)
+{
+    remove(path);
+
+    Device& device    = _devices[path];
+    device.brightness = _sources.add(classPrefix + path + "/brightness");
+    device.value      = value;
+
+    // Backlights report every change as a uevent, LEDs only what the
+    // hardware changed through brightness_hw_changed
+    if (_netlink && path.startsWith("leds/"))
+    {
+        const QByteArray file = (_sources.root() + classPrefix + path + "/brightness_hw_changed").toLocal8Bit();
+        device.hwChangedFd    = ::open(file.constData(), O_RDONLY | O_CLOEXEC);
+
+        if (device.hwChangedFd >= 0)
+        {
+            // sysfs flags changes as POLLPRI, which Qt reports as an exception
+            device.hwChanged = std::make_unique<QSocketNotifier>(device.hwChangedFd, QSocketNotifier::Exception);
+
+            connect(device.hwChanged.get(), &QSocketNotifier::activated, this, [this, path]
+            {
+                const auto it = _devices.find(path);
+                if (it == _devices.end()) return;
+
+                // The notification stays raised until the attribute is read
+                char buffer[32];
+                [[maybe_unused]] const auto n = ::pread(it->second.hwChangedFd, buffer, sizeof(buffer), 0);
+
+                if (refresh(it->second))
+                    emit changed(path, it->second.value);
+            });
+        }
+    }
+
+    device.polled = !_netlink || (path.startsWith("leds/") && device.hwChangedFd < 0);
+
+    if (device.polled && ++_polled == 1)
+    {
+        _poll.setInterval(minPollInterval);
+        _poll.start();
+    }
+}
+
+void BrightnessNotifier::remove(const QString& path)
+{
+    const auto it = _devices.find(path);
+    if (it == _devices.end()) return;
+
+    auto& device = it->second;
+
+    // add() gets the same handle back if the device returns, it starts over
+    _sources.reset(device.brightness);
+
+    device.hwChanged.reset();
+    if (device.hwChangedFd >= 0)
+        ::close(device.hwChangedFd);
+
+    if (device.polled && !device.suspended && --_polled == 0)
+        _poll.stop();
+
+    _devices.erase(it);
+}
+
+void BrightnessNotifier::suspend(const QString& path, const bool suspended)
+{
+    const auto it = _devices.find(path);
+    if (it == _devices.end() || it->second.suspended == suspended) return;
+
+    auto& device = it->second;
+    device.suspended = suspended;
+
+    if (!device.polled) return;
+
+    if (suspended)
+    {
+        if (--_polled == 0)
+            _poll.stop();
+    }
+    else if (++_polled == 1)
+    {
+        _poll.setInterval(minPollInterval);
+        _poll.start();
+    }
+}
+
+void BrightnessNotifier::openNetlink()
+{
+    _netlinkFd = ::socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, NETLINK_KOBJECT_UEVENT);
+
+    sockaddr_nl address {};
+    address.nl_family = AF_NETLINK;
+    address.nl_groups = kernelUeventGroup;
+
+    if (_netlinkFd < 0 || ::bind(_netlinkFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0)
+    {
+        qWarning() << "Can't listen for uevents, polling brightness instead:" << strerror(errno);
+
+        if (_netlinkFd >= 0)
+            ::close(_netlinkFd);
+        _netlinkFd = -1;
+        return;
+    }
+
+    _netlink = std::make_unique<QSocketNotifier>(_netlinkFd, QSocketNotifier::Read);
+    connect(_netlink.get(), &QSocketNotifier::activated, this, &BrightnessNotifier::readNetlink);
+}
+
+void BrightnessNotifier::readNetlink()
+{
+    char buffer[8192];
+
+    for (;;)
+    {
+        sockaddr_nl sender {};
+        iovec data { buffer, sizeof(buffer) };
+
+        msghdr message {};
+        message.msg_name    = &sender;
+        message.msg_namelen = sizeof(sender);
+        message.msg_iov     = &data;
+        message.msg_iovlen  = 1;
+
+        const ssize_t n = ::recvmsg(_netlinkFd, &message, 0);
+        if (n < 0)
+        {
+            if (errno == EINTR) continue;
+
+            // The socket overran and events were lost, read everything again
+            if (errno == ENOBUFS)
+            {
+                std::vector<QString> paths;
+                for (auto& [path, device] : _devices)
+                    if (refresh(device))
+                        paths.push_back(path);
+
+                for (const auto& path : paths)
+                    if (const auto it = _devices.find(path); it != _devices.end())
+                        emit changed(path, it->second.value);
+                continue;
+            }
+
+            break; // EAGAIN, drained
+        }
+
+        // Only the kernel sends on this group, anything else is spoofed
+        if (sender.nl_pid != 0) continue;
+
+        // "action@devpath" followed by KEY=value fields, each NUL terminated
+        QByteArrayView action, subsystem, devpath;
+        for (qsizetype at = 0; at < n;)
+        {
+            const QByteArrayView field(buffer + at, static_cast<qsizetype>(strnlen(buffer + at, n - at)));
+            at += field.size() + 1;
+
+            if (field.startsWith("ACTION="))
+                action = field.sliced(7);
+            else if (field.startsWith("SUBSYSTEM="))
+                subsystem = field.sliced(10);
+            else if (field.startsWith("DEVPATH="))
+                devpath = field.sliced(8);
+        }
+
+        if ((subsystem != "backlight" && subsystem != "leds") || devpath.isEmpty()) continue;
+
+        const QString path = QString::fromLatin1(subsystem) + '/'
+                           + QString::fromLocal8Bit(devpath.sliced(devpath.lastIndexOf('/') + 1));
+
+        if (action == "add")
+            emit deviceAdded(path);
+
+        else if (action == "remove")
+            emit deviceRemoved(path);
+
+        else if (action == "change")
+            if (const auto it = _devices.find(path); it != _devices.end() && refresh(it->second))
+                emit changed(path, it->second.value);
+    }
+}
+
+bool BrightnessNotifier::refresh(Device& device)
+{
+    const QByteArrayView data = _sources.read(device.brightness);
+
+    bool ok = false;
+    const int value = data.trimmed().toInt(&ok);
+
+    if (!ok || value == device.value) return false;
+
+    device.value = value;
+    return true;
+}
+
+void BrightnessNotifier::poll()
+{
+    std::vector<QString> paths;
+    for (auto& [path, device] : _devices)
+        if (device.polled && !device.suspended && refresh(device))
+            paths.push_back(path);
+
+    // Faster right after a change, slower the longer nothing happens
+    _poll.setInterval(paths.empty() ? std::min(_poll.interval() * 2, maxPollInterval) : minPollInterval);
+    if (_polled > 0)
+        _poll.start();
+
+    // Receivers may add or remove devices
+    for (const auto& path : paths)
+        if (const auto it = _devices.find(path); it != _devices.end())
+            emit changed(path, it->second.value);
+}
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <qobject.h>
+#include <qsocketnotifier.h>
+#include <qstring.h>
+#include <qtimer.h>
+
+#include <memory>
+#include <unordered_map>
+
+#include "collection/source_registry.h"
+
+namespace hw_monitor {
+
+// Tells when the brightness of a backlight or LED changed, whoever changed
+// it. Devices are named by their path below /sys/class, e.g.
+// "backlight/intel_backlight".
+//
+// inotify never fires for sysfs, so changes come from
+//  - kernel uevents on a netlink socket: backlights send one per change,
+//    hotkeys and ACPI included, and every device one when it comes or goes
+//  - POLLPRI on brightness_hw_changed, for LEDs the hardware changes itself
+//  - polling, only for devices with neither. The interval starts short after
+//    a change and backs off while nothing happens.
+//
+// Against a fixture root the kernel events describe the wrong tree, there
+// every device is polled.
+class BrightnessNotifier : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit BrightnessNotifier(const QString& root, QObject* parent = nullptr);
+    ~BrightnessNotifier() override;
+
+    // Starts tracking path, value is the brightness it was last seen with
+    void add(const QString& path, int value);
+    void remove(const QString& path);
+
+    // Stops polling path while its brightness is driven by the kernel,
+    // e.g. by a blinking LED trigger
+    void suspend(const QString& path, bool suspended);
+
+signals:
+    // The brightness of a tracked device is not what it was last seen with
+    void changed(const QString& path, int value);
+
+    // A backlight or LED device appeared or went away, tracked or not
+    void deviceAdded(const QString& path);
+    void deviceRemoved(const QString& path);
+
+private:
+    struct Device
+    {
+        SourceRegistry::Handle_t brightness = 0;
+        int value = 0;
+
+        // brightness_hw_changed, -1 without
+        int hwChangedFd = -1;
+        std::unique_ptr<QSocketNotifier> hwChanged;
+
+        bool polled    = false;
+        bool suspended = false;
+    };
+
+    SourceRegistry _sources;
+    std::unordered_map<QString, Device> _devices;
+
+    int _netlinkFd = -1;
+    std::unique_ptr<QSocketNotifier> _netlink;
+
+    QTimer _poll;
+    qsizetype _polled = 0; // polled and not suspended
+
+    void openNetlink();
+    void readNetlink();
+
+    // Reads the brightness again, returns whether it changed. Callers emit
+    // changed() once they no longer iterate _devices.
+    bool refresh(Device& device);
+    void poll();
+};
+}
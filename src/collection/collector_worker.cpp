@@ -0,0 +1,109 @@
+#include "collector_worker.h"
+
+#include <qdebug.h>
+#include <qlogging.h>
+
+#include <cstring>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/sysinfo.h>
+
+CollectorWorker::CollectorWorker(Buffer_t& buffer, const QString& root)
+: _buffer(buffer)
+, _collector(root)
+{}
+
+quint64 CollectorWorker::syscallsPerTick() const
+{
+    return _syscallsPerTick.load(std::memory_order_relaxed);
+}
+
+void CollectorWorker::start(const int sampleRate)
+{
+    _timer = new QTimer(this);
+    connect(_timer, &QTimer::timeout, this, &CollectorWorker::collect);
+
+    _sampleRate = sampleRate;
+
+    if (_groups != MetricGroup::None)
+        collect();
+    updateTimer();
+}
+
+void CollectorWorker::sampleRate(const int sampleRate)
+{
+    _sampleRate = sampleRate;
+    updateTimer();
+}
+
+void CollectorWorker::groups(const MetricGroups groups)
+{
+    const bool wasIdle = _groups == MetricGroup::None;
+    _groups = groups;
+
+    // New subscribers should not wait a whole interval for their first data
+    if (_timer && wasIdle && _groups != MetricGroup::None)
+        collect();
+
+    updateTimer();
+}
+
+void CollectorWorker::updateTimer()
+{
+    if (!_timer) return;
+
+    if (_sampleRate <= 0 || _groups == MetricGroup::None)
+        _timer->stop();
+    else if (!_timer->isActive() || _timer->interval() != _sampleRate)
+        _timer->start(_sampleRate);
+}
+
+void CollectorWorker::idlePriority(const bool enabled)
+{
+    sched_param param {};
+    param.sched_priority = 0;
+
+    const int policy = enabled ? SCHED_IDLE : SCHED_OTHER;
+    if (const int r = pthread_setschedparam(pthread_self(), policy, &param); r != 0)
+        qWarning() << "Failed to set collector scheduling policy:" << strerror(r);
+}
+
+void CollectorWorker::affinity(const QList<int>& cpus)
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+
+    if (cpus.isEmpty())
+    {
+        for (int cpu = 0; cpu < get_nprocs_conf() && cpu < CPU_SETSIZE; ++cpu)
+            CPU_SET(cpu, &set);
+    }
+
+    for (const int cpu : cpus)
+        if (cpu >= 0 && cpu < CPU_SETSIZE)
+            CPU_SET(cpu, &set);
+
+    if (const int r = pthread_setaffinity_np(pthread_self(), sizeof(set), &set); r != 0)
+        qWarning() << "Failed to set collector cpu affinity:" << strerror(r);
+}
+
+void CollectorWorker::collect()
+{
+    auto& snapshot = _buffer.back();
+
+    // Consumers may still hold the snapshot that was published from this slot
+    if (!snapshot || snapshot.use_count() > 1)
+        snapshot = std::make_shared<Data_Cpu>();
+    else
+        std::atomic_thread_fence(std::memory_order_acquire); // pairs with the release of the last consumer
+
+    _collector.collect(CpuCollector::Options {
+        .filterMode = FilterMode::Inclusive,
+        .filter     = {},
+        .groups     = _groups,
+    }, *snapshot);
+    _syscallsPerTick.store(_collector.syscallsPerTick(), std::memory_order_relaxed);
+
+    _buffer.publish();
+    emit published();
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <qlist.h>
+#include <qobject.h>
+#include <qtimer.h>
+
+#include <atomic>
+#include <memory>
+
+#include "cpu_collector.h"
+#include "cpu_data.h"
+#include "../enums.h"
+#include "../util/triple_buffer.h"
+
+// Lives on the collector thread, owns the timer and every open file handle.
+// Finished snapshots are handed to the GUI thread through the triple buffer,
+// published() only tells it to pick them up. A slot whose snapshot is no
+// longer referenced by any consumer is refilled in place.
+class CollectorWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    using Buffer_t = TripleBuffer<std::shared_ptr<Data_Cpu>>;
+
+    // root is prepended to every procfs/sysfs path, see defaultFsRoot()
+    CollectorWorker(Buffer_t& buffer, const QString& root);
+
+    // Safe to call from any thread
+    [[nodiscard]] quint64 syscallsPerTick() const;
+
+public slots:
+    // Collects once, then every sampleRate ms (0 = never)
+    void start(int sampleRate);
+
+    void sampleRate(int sampleRate);
+
+    // Only these groups are collected, the timer stops while there are none
+    void groups(MetricGroups groups);
+
+    // Runs the thread with SCHED_IDLE so it never competes with real work
+    void idlePriority(bool enabled);
+
+    // Pins the thread to the given cpus, an empty list allows all of them
+    void affinity(const QList<int>& cpus);
+
+    void collect();
+
+signals:
+    void published();
+
+private:
+    Buffer_t& _buffer;
+
+    CpuCollector _collector;
+    QTimer* _timer = nullptr;
+
+    int _sampleRate = 0;
+    MetricGroups _groups = MetricGroup::None;
+
+    void updateTimer();
+
+    std::atomic<quint64> _syscallsPerTick = 0;
+};
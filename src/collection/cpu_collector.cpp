@@ -1,226 +1,192 @@
 #include "cpu_collector.h"
 
-#include <qdir.h>
-#include <qfile.h>
+#include <qdebug.h>
+#include <qtextstream.h>
 #include <qtypes.h>
-#include <qregularexpression.h>
+#include <chrono>
+#include <utility>
 
 #include "cpu_data.h"
+#include "proc_stat_parser.h"
 
-using Mappings_t = std::unordered_map<qsizetype, QPair<qsizetype, qsizetype>>;
+static constexpr auto cpuSysPath = "/sys/devices/system/cpu/";
 
-// Returns a list of all cores, (not grouped by cpu, will do that later)
-Mappings_t readCpuInfo(const CpuCollector::Options& options, Data_Cpu& data)
-{
-    Mappings_t mappings{};
+CpuCollector::CpuCollector(const QString& root)
+: _sources(root)
+, _topology(_sources)
+, _thermal(_sources)
+, _power(_sources)
+, _stat(_sources.add("/proc/stat"))
+, _loadAvg(_sources.add("/proc/loadavg"))
+{}
 
-    QFile file("/proc/cpuinfo");
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+void CpuCollector::readStat(Data_Cpu& data, const Mappings_t& mappings, const MetricGroups groups)
+{
+    const QByteArrayView raw = _sources.read(_stat);
+    if (raw.isEmpty())
     {
-        qWarning() << "Failed to open /proc/cpuinfo. CpuMonitor data will be incomplete";
-        return mappings;
+        qWarning() << "Failed to read /proc/stat. CpuMonitor data will be incomplete";
+        return;
     }
 
-    // I assume that at least one cpu should be found
-    Data_Cpu::CpuData* currentCpu = &data.cpus.emplace_back();
-    std::unique_ptr<Data_Cpu::CoreData> currentCore = nullptr;
+    parseProcStat(raw, data, mappings, groups);
+}
+
+//# Utils for /sys/devices/system/cpu/cpufreq
+void CpuCollector::rebuildFreqHandles(const Mappings_t& mappings)
+{
+    _freq.clear();
+    _freq.reserve(mappings.size());
 
-    const QRegularExpression re("^\\s*([^:]+)\\s*:\\s*(.+)$"); // key : value
+    for (const auto& [index, location] : mappings)
+    {
+        const QString basePath = cpuSysPath + QString("cpu%1/cpufreq/").arg(index);
+
+        _freq.push_back({
+            _sources.add(basePath + "cpuinfo_min_freq"),
+            _sources.add(basePath + "cpuinfo_max_freq"),
+            _sources.add(basePath + "scaling_cur_freq"),
+            location.first,
+            location.second,
+        });
+    }
+}
 
-    QString contents = file.readAll();
-    QStringList lines = contents.split('\n', Qt::SkipEmptyParts);
+void CpuCollector::readFreqMinMax(Data_Cpu& data)
+{
+    for (const auto& [hMin, hMax, hNow, cpuIndex, coreIndex] : _freq)
+    {
+        auto& core = data.cpus[cpuIndex].cores[coreIndex];
 
-    qsizetype coreCount = 0;
+        core.freqMin = _sources.read(hMin).trimmed().toDouble();
+        core.freqMax = _sources.read(hMax).trimmed().toDouble();
+        core.freqNow = _sources.read(hNow).trimmed().toDouble();
+    }
+}
 
-    for (const auto& lineRaw : lines)
+void CpuCollector::readCpuMHz(Data_Cpu& data, const bool freqRead)
+{
+    for (const auto& [hMin, hMax, hNow, cpuIndex, coreIndex] : _freq)
     {
-        QString line = lineRaw;
-        if (line.isEmpty())
-            continue;
-
-        QRegularExpressionMatch match = re.match(line);
-        if (!match.hasMatch())
-            continue;
-
-        QString key   = match.captured(1).trimmed();
-        QString value = match.captured(2).trimmed();
-
-        if (key == "processor")
-        {
-            if (currentCore != nullptr)
-            {
-                if (currentCpu == nullptr) throw std::runtime_error("Failed to assign core to cpu. No cpu found?");
-                currentCpu->cores.push_back(*currentCore);
-
-                mappings.insert({coreCount++, { data.cpus.size() - 1, currentCpu->cores.size() - 1 }});
-            }
-
-            currentCore.reset(new Data_Cpu::CoreData);
-        }
-        else if (key == "physical id" && value.toInt() > data.cpus.size() - 1)
-            currentCpu = &data.cpus.emplace_back();
-        else if (key == "model name")
-            currentCpu->name = value;
-        if (options.filterMode == FilterMode::Inclusive && options.filter.contains(key))
-            currentCore->cpuInfoEntries.insert(key, value);
-        else if (options.filterMode == FilterMode::Exclusive && !options.filter.contains(key))
-            currentCore->cpuInfoEntries.insert(key, value);
+        auto& core = data.cpus[cpuIndex].cores[coreIndex];
+
+        bool ok = true;
+        const double kHz = freqRead ? core.freqNow : _sources.read(hNow).trimmed().toDouble(&ok);
+
+        // Without cpufreq, e.g. in most VMs, the entry keeps what cpuinfo said
+        if (!ok || kHz <= 0) continue;
+
+        core.cpuInfoEntries.insert("cpu MHz", QString::number(kHz / 1000, 'f', 3));
     }
+}
 
-    currentCpu->cores.push_back(*currentCore);
-    mappings.insert({coreCount++, { data.cpus.size() - 1, currentCpu->cores.size() - 1 }});
+//# Utils for /proc/loadavg
+void CpuCollector::readLoadAvg(Data_Cpu& data)
+{
+    const QByteArrayView raw = _sources.read(_loadAvg);
+    if (raw.isEmpty())
+        return;
 
-    return mappings;
+    const QByteArray contents = QByteArray::fromRawData(raw.data(), raw.size());
+    QTextStream in(contents);
+    in >> data.load1 >> data.load5 >> data.load15;
 }
 
-void parseStatCpu(Data_Cpu::Stats& stats, const QStringList& parts)
+Data_Cpu CpuCollector::collect(const Options& options)
 {
-    stats.user       = parts[ 1].toDouble();
-    stats.nice       = parts[ 2].toDouble();
-    stats.system     = parts[ 3].toDouble();
-    stats.idle       = parts[ 4].toDouble();
-    stats.iowait     = parts[ 5].toDouble();
-    stats.irq        = parts[ 6].toDouble();
-    stats.softirq    = parts[ 7].toDouble();
-    stats.steal      = parts[ 8].toDouble();
-    stats.guest      = parts[ 9].toDouble();
-    stats.guest_nice = parts[10].toDouble();
+    Data_Cpu data;
+    collect(options, data);
+    return data;
 }
 
-void readStat(Data_Cpu& data, const Mappings_t& mappings)
+void CpuCollector::collect(const Options& options, Data_Cpu& data)
 {
-    QFile file("/proc/stat");
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+    static constexpr MetricGroups topologyGroups = MetricGroup::CoreStats | MetricGroup::Frequency | MetricGroup::CpuInfo
+                                                 | MetricGroup::Temperature | MetricGroup::Power;
+    static constexpr MetricGroups statGroups     = MetricGroup::CoreStats | MetricGroup::Interrupts | MetricGroup::SoftIrqs;
+
+    const MetricGroups groups = options.groups;
+
+    _sources.beginTick();
+
+    const bool wantsTopology = groups.testAnyFlags(topologyGroups);
+    quint64 generation = 0;
+
+    if (wantsTopology)
     {
-        qWarning() << "Failed to open /proc/stat. CpuMonitor data will be incomplete";
-        return;
+        if (_topology.refresh(options.filterMode, options.filter))
+            rebuildFreqHandles(_topology.mappings());
+        generation = _topology.generation();
     }
 
-    QString contents  = file.readAll();
-    QStringList lines = contents.split('\n', Qt::SkipEmptyParts);
-
-    for (const auto& line : lines)
+    if (data.groups != groups || data.topologyGeneration != generation)
     {
-        if (line.isEmpty())
-            continue;
-
-        QStringList parts = line.split(QRegularExpression("\\s+"), Qt::SkipEmptyParts);
-
-        if (parts[0] == "cpu") // global cpu stats
-            parseStatCpu(data.globalStats.totalCpuStats, parts);
-        else if (line.startsWith("cpu"))
-        {
-            bool ok = false;
-            const quint64 index = parts[0].mid(3).toULongLong(&ok);
-
-            if (!ok) throw std::runtime_error("Failed to parse cpu index");
-
-            auto [cpuIndex, coreIndex] = mappings.at(index);
-            auto& core = data.cpus[cpuIndex].cores[coreIndex];
-
-            parseStatCpu(core.stats, parts);
-        }
-        else if (parts[0] == "intr") // interrupts
-        {
-            data.globalStats.interrupts.clear();
-            for (int i = 1; i < parts.size(); ++i)
-                data.globalStats.interrupts.push_back(parts[i].toULongLong());
-        }
-        else if (parts[0] == "ctxt") // context switches
-            data.globalStats.contextSwitches = parts[1].toULongLong();
-        else if (parts[0] == "btime") // boot time
-            data.globalStats.bootTime = parts[1].toULongLong();
-        else if (parts[0] == "processes") // total forks
-            data.globalStats.processes = parts[1].toULongLong();
-        else if (parts[0] == "procs_running")
-            data.globalStats.procsRunning = parts[1].toULongLong();
-        else if (parts[0] == "procs_blocked")
-            data.globalStats.procsBlocked = parts[1].toULongLong();
-        else if (parts[0] == "softirq")
-        {
-            data.globalStats.softIrqs.clear();
-            for (int i = 1; i < parts.size(); ++i)
-                data.globalStats.softIrqs.push_back(parts[i].toULongLong());
-        }
+        data = {};
+
+        // Shares the cached names and cpuinfo entries, only the readings detach
+        if (wantsTopology)
+            data.cpus = _topology.cpus();
     }
-}
 
+    data.groups             = groups;
+    data.topologyGeneration = generation;
 
-//# Utils for /sys/devices/system/cpu/cpufreq
-struct FreqEntry
-{
-    qreal min;
-    qreal max;
-    qreal now;
-};
+    if (wantsTopology)
+        stageDone("topology");
 
-void readFreqMinMax(Data_Cpu& data, const Mappings_t& mappings)
-{
-    const QDir cpuDir("/sys/devices/system/cpu/");
-    QStringList cpuDirs = cpuDir.entryList(QStringList() << "cpu[0-9]*", QDir::Dirs);
+    if (groups.testAnyFlags(statGroups))
+    {
+        readStat(data, _topology.mappings(), groups);
+        stageDone("stat");
+    }
 
-    for (const QString& cpu : cpuDirs)
+    if (groups.testFlag(MetricGroup::Frequency))
     {
-        bool ok = false;
-        quint64 index = cpu.mid(3).toULongLong(&ok);
-        if (!ok) continue;
-
-        QString basePath = cpuDir.absoluteFilePath(cpu + "/cpufreq/");
-
-        QFile fMin(basePath + "cpuinfo_min_freq");
-        QFile fMax(basePath + "cpuinfo_max_freq");
-        QFile fNow(basePath + "scaling_cur_freq");
-
-        qreal minFreq = 0;
-        qreal maxFreq = 0;
-        qreal nowFreq = 0;
-
-        if (fMin.open(QIODevice::ReadOnly | QIODevice::Text))
-        {
-            minFreq = fMin.readAll().trimmed().toDouble();
-            fMin.close();
-        }
-
-        if (fMax.open(QIODevice::ReadOnly | QIODevice::Text))
-        {
-            maxFreq = fMax.readAll().trimmed().toDouble();
-            fMax.close();
-        }
-
-        if (fNow.open(QIODevice::ReadOnly | QIODevice::Text))
-        {
-            nowFreq = fNow.readAll().trimmed().toDouble();
-            fNow.close();
-        }
-
-        auto [cpuIndex, coreIndex] = mappings.at(index);
-        auto& core = data.cpus[cpuIndex].cores[coreIndex];
+        readFreqMinMax(data);
+        stageDone("freq");
+    }
 
-        core.freqMin = minFreq;
-        core.freqMax = maxFreq;
-        core.freqNow = nowFreq;
+    // Detaches the cached entries of every core, only done when kept
+    if (groups.testFlag(MetricGroup::CpuInfo) && _topology.cpuMHz())
+    {
+        readCpuMHz(data, groups.testFlag(MetricGroup::Frequency));
+        stageDone("cpuinfo");
     }
-}
 
-//# Utils for /proc/loadavg
-void readLoadAvg(Data_Cpu& data)
-{
-    QFile f("/proc/loadavg");
-    if (f.open(QIODevice::ReadOnly | QIODevice::Text))
+    if (groups.testFlag(MetricGroup::Temperature))
     {
-        QTextStream in(&f);
-        in >> data.load1 >> data.load5 >> data.load15;
+        _thermal.collect(data, _topology.mappings(), _topology.packages(), generation);
+        stageDone("thermal");
     }
+
+    if (groups.testFlag(MetricGroup::Power))
+    {
+        const auto now = std::chrono::steady_clock::now().time_since_epoch();
+        _power.collect(data, _topology.packages(), generation, std::chrono::duration_cast<std::chrono::microseconds>(now).count());
+        stageDone("power");
+    }
+
+    if (groups.testFlag(MetricGroup::LoadAvg))
+    {
+        readLoadAvg(data);
+        stageDone("loadavg");
+    }
+
+    _syscallsPerTick = _sources.syscalls();
 }
 
-Data_Cpu CpuCollector::collect(const Options& options)
+quint64 CpuCollector::syscallsPerTick() const
 {
-    Data_Cpu data;
+    return _syscallsPerTick;
+}
 
-    const auto mappings = readCpuInfo(options, data);
-    readStat(data, mappings);
-    readFreqMinMax(data, mappings);
-    readLoadAvg(data);
+void CpuCollector::setStageProbe(StageProbe_t probe)
+{
+    _probe = std::move(probe);
+}
 
-    return data;
-}
\ No newline at end of file
+void CpuCollector::stageDone(const std::string_view stage) const
+{
+    if (_probe)
+        _probe(stage);
+}
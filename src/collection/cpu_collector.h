@@ -1,18 +1,84 @@
 #pragma once
 
 #include <qstring.h>
+#include <functional>
+#include <string_view>
 #include <unordered_set>
+#include <vector>
 
 #include "cpu_data.h"
+#include "cpu_topology.h"
+#include "power_collector.h"
+#include "source_registry.h"
+#include "thermal_collector.h"
 #include "../enums.h"
 
-struct CpuCollector
+class CpuCollector
 {
+public:
     struct Options
     {
         const FilterMode filterMode;
         const std::unordered_set<QString> filter;
+
+        // Stages that are not needed by any of these groups are skipped
+        const MetricGroups groups = MetricGroup::All;
     };
 
-    static Data_Cpu collect(const Options& options);
-};
\ No newline at end of file
+    // Called at the end of every stage of collect() with the stage name
+    using StageProbe_t = std::function<void(std::string_view stage)>;
+
+    // root is prepended to every procfs/sysfs path, empty means the live system
+    explicit CpuCollector(const QString& root = {});
+
+    Data_Cpu collect(const Options& options);
+
+    // Collects into data, reusing its storage when it was filled by an earlier
+    // call with the same groups and topology. Steady state ticks then do not
+    // allocate.
+    void collect(const Options& options, Data_Cpu& data);
+
+    // For benchmarks, unset by default
+    void setStageProbe(StageProbe_t probe);
+
+    // open/pread/close calls issued by the last collect()
+    [[nodiscard]] quint64 syscallsPerTick() const;
+
+private:
+    using Handle_t = SourceRegistry::Handle_t;
+
+    struct FreqHandles
+    {
+        Handle_t min;
+        Handle_t max;
+        Handle_t now;
+
+        qsizetype cpuIndex;
+        qsizetype coreIndex;
+    };
+
+    SourceRegistry _sources;
+    CpuTopology _topology;
+    ThermalCollector _thermal;
+    PowerCollector _power;
+
+    Handle_t _stat;
+    Handle_t _loadAvg;
+
+    // Rebuilt together with the topology
+    std::vector<FreqHandles> _freq;
+
+    quint64 _syscallsPerTick = 0;
+
+    StageProbe_t _probe;
+
+    void stageDone(std::string_view stage) const;
+
+    void rebuildFreqHandles(const Mappings_t& mappings);
+
+    void readStat(Data_Cpu& data, const Mappings_t& mappings, MetricGroups groups);
+    void readFreqMinMax(Data_Cpu& data);
+    // The "cpu MHz" cpuinfo entry, from freqNow if freqRead
+    void readCpuMHz(Data_Cpu& data, bool freqRead);
+    void readLoadAvg(Data_Cpu& data);
+};
@@ -3,6 +3,19 @@
 #include <QVariant>
 #include <qstring.h>
 #include <qtypes.h>
+#include <qpair.h>
+
+#include <map>
+#include <memory>
+#include <unordered_map>
+
+#include "../enums.h"
+
+// Logical cpu index -> { cpu index, core index } in Data_Cpu::cpus
+using Mappings_t = std::unordered_map<qsizetype, QPair<qsizetype, qsizetype>>;
+
+// Physical package id -> cpu index in Data_Cpu::cpus, ordered by id
+using Packages_t = std::map<qsizetype, qsizetype>;
 
 struct Data_Cpu
 {
@@ -19,9 +32,10 @@ struct Data_Cpu
         quint64 guest      = 0; // running a virtual CPU
         quint64 guest_nice = 0; // guest time with low priority
 
+        // guest and guest_nice are already accounted in user and nice
         [[nodiscard]] quint64 total() const
         {
-            return nice + system + idle + iowait + irq + softirq + steal + guest + guest_nice;
+            return user + nice + system + idle + iowait + irq + softirq + steal;
         }
 
         Stats& operator+=(const Stats& other)
@@ -58,12 +72,20 @@ struct Data_Cpu
         QVariantMap cpuInfoEntries;
     };
 
+    // A RAPL domain inside a package, e.g. "core", "uncore" or "dram"
+    struct PowerDomain
+    {
+        QString name;
+        float   draw = 0.0; // watts
+    };
+
     struct CpuData : Entry
     {
         QString name = nullptr;
-        float   draw = 0.0;
+        float   draw = 0.0; // watts, the whole package
 
         QVector<CoreData> cores;
+        QVector<PowerDomain> domains;
     };
 
     struct StatsGlobal
@@ -81,6 +103,9 @@ struct Data_Cpu
         QVector<quint64> softIrqs;
     };
 
+    MetricGroups groups = MetricGroup::None; // groups that were collected
+    quint64 topologyGeneration = 0;          // changes when cpus are hotplugged
+
     float load1  = 0; // 1-minute load average
     float load5  = 0; // 5-minute load average
     float load15 = 0; // 15-minute load average
@@ -88,4 +113,7 @@ struct Data_Cpu
     StatsGlobal globalStats;
 
     QVector<CpuData> cpus;
-};
\ No newline at end of file
+};
+
+// Published snapshots are shared between all consumers and never modified
+using Snapshot_Cpu = std::shared_ptr<const Data_Cpu>;
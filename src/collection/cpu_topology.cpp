@@ -0,0 +1,139 @@
+#include "cpu_topology.h"
+
+#include <qdebug.h>
+#include <qlogging.h>
+#include <qregularexpression.h>
+
+CpuTopology::CpuTopology(SourceRegistry& sources)
+: _sources(sources)
+, _online(sources.add("/sys/devices/system/cpu/online"))
+, _cpuInfo(sources.add("/proc/cpuinfo"))
+{}
+
+bool CpuTopology::refresh(const FilterMode filterMode, const std::unordered_set<QString>& filter)
+{
+    // Some containers hide the file, then only the filter can invalidate
+    const QByteArrayView online = _sources.read(_online);
+
+    if (_valid && online == _onlineState && filterMode == _filterMode && filter == _filter)
+        return false;
+
+    if (_valid)
+        _sources.retryMissing(); // hotplugged cpus bring their sysfs files back
+
+    _onlineState = online.toByteArray();
+    _filterMode  = filterMode;
+    _filter      = filter;
+
+    parseCpuInfo();
+
+    _valid = true;
+    ++_generation;
+    return true;
+}
+
+const QVector<Data_Cpu::CpuData>& CpuTopology::cpus() const
+{
+    return _cpus;
+}
+
+const Mappings_t& CpuTopology::mappings() const
+{
+    return _mappings;
+}
+
+const Packages_t& CpuTopology::packages() const
+{
+    return _packages;
+}
+
+bool CpuTopology::cpuMHz() const
+{
+    return _cpuMHz;
+}
+
+quint64 CpuTopology::generation() const
+{
+    return _generation;
+}
+
+void CpuTopology::parseCpuInfo()
+{
+    _cpus.clear();
+    _mappings.clear();
+    _packages.clear();
+
+    const QByteArrayView raw = _sources.read(_cpuInfo);
+    if (raw.isEmpty())
+    {
+        qWarning() << "Failed to read /proc/cpuinfo. CpuMonitor data will be incomplete";
+        return;
+    }
+
+    // One block per logical cpu, assigned once it is complete because
+    // "model name" comes before "physical id"
+    struct Block
+    {
+        qsizetype processor  = -1;
+        qsizetype physicalId = 0;
+        QString name;
+        QVariantMap entries;
+    } block;
+
+    const auto flush = [this, &block]
+    {
+        if (block.processor < 0) return;
+
+        // Physical ids can be sparse, e.g. with offline sockets, cpus get
+        // one index per package in order of appearance
+        const auto [package, added] = _packages.try_emplace(block.physicalId, _cpus.size());
+        if (added)
+            _cpus.emplace_back();
+
+        const qsizetype cpuIndex = package->second;
+
+        auto& cpu = _cpus[cpuIndex];
+        if (!block.name.isEmpty())
+            cpu.name = block.name;
+
+        auto& core = cpu.cores.emplace_back();
+        core.cpuInfoEntries = block.entries;
+
+        _mappings.insert({block.processor, { cpuIndex, cpu.cores.size() - 1 }});
+        block = {};
+    };
+
+    const QRegularExpression re("^\\s*([^:]+)\\s*:\\s*(.+)$"); // key : value
+
+    const QString contents = QString::fromUtf8(raw);
+    const QStringList lines = contents.split('\n', Qt::SkipEmptyParts);
+
+    for (const auto& line : lines)
+    {
+        QRegularExpressionMatch match = re.match(line);
+        if (!match.hasMatch())
+            continue;
+
+        QString key   = match.captured(1).trimmed();
+        QString value = match.captured(2).trimmed();
+
+        if (key == "processor")
+        {
+            flush();
+            block.processor = value.toLongLong();
+        }
+        else if (key == "physical id")
+            block.physicalId = qMax(value.toLongLong(), 0LL);
+        else if (key == "model name")
+            block.name = value;
+
+        if (_filterMode == FilterMode::Inclusive && _filter.contains(key))
+            block.entries.insert(key, value);
+        else if (_filterMode == FilterMode::Exclusive && !_filter.contains(key))
+            block.entries.insert(key, value);
+    }
+
+    _cpuMHz = _filterMode == FilterMode::Inclusive ? _filter.contains("cpu MHz") : !_filter.contains("cpu MHz");
+
+    flush();
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <qbytearray.h>
+#include <qstring.h>
+#include <unordered_set>
+
+#include "cpu_data.h"
+#include "source_registry.h"
+#include "../enums.h"
+
+// Cached result of parsing /proc/cpuinfo. The content is static apart from
+// "cpu MHz", which CpuCollector refreshes from cpufreq every tick, so it is
+// only parsed again when /sys/devices/system/cpu/online or the entry filter
+// changes.
+class CpuTopology
+{
+public:
+    explicit CpuTopology(SourceRegistry& sources);
+
+    // Checks the online cpus and re-parses cpuinfo if needed.
+    // Returns true if the topology was rebuilt.
+    bool refresh(FilterMode filterMode, const std::unordered_set<QString>& filter);
+
+    // Cpus with their names, cores and cpuinfo entries but no readings
+    [[nodiscard]] const QVector<Data_Cpu::CpuData>& cpus() const;
+    [[nodiscard]] const Mappings_t& mappings() const;
+    [[nodiscard]] const Packages_t& packages() const;
+
+    // The filter keeps the "cpu MHz" entry
+    [[nodiscard]] bool cpuMHz() const;
+
+    // Incremented on every rebuild
+    [[nodiscard]] quint64 generation() const;
+
+private:
+    using Handle_t = SourceRegistry::Handle_t;
+
+    SourceRegistry& _sources;
+
+    Handle_t _online;
+    Handle_t _cpuInfo;
+
+    bool _valid = false;
+    QByteArray _onlineState;
+
+    FilterMode _filterMode = FilterMode::Inclusive;
+    std::unordered_set<QString> _filter;
+    bool _cpuMHz = false;
+
+    QVector<Data_Cpu::CpuData> _cpus;
+    Mappings_t _mappings;
+    Packages_t _packages;
+
+    quint64 _generation = 0;
+
+    void parseCpuInfo();
+};
@@ -0,0 +1,127 @@
+#include "power_collector.h"
+
+#include <qdebug.h>
+#include <qdir.h>
+#include <qfile.h>
+
+#include "../util/fs_root.h"
+
+static constexpr auto powercapPath = "/sys/class/powercap/";
+
+PowerCollector::PowerCollector(SourceRegistry& sources)
+: _sources(sources)
+{}
+
+void PowerCollector::discover(const Packages_t& packages)
+{
+    _zones.clear();
+
+    const QString& root = _sources.root();
+    const QDir powercap(root + powercapPath);
+
+    // Tell why powerDraw stays 0 once, not every tick. Recent kernels keep
+    // the counters to root.
+    bool warned = false;
+    const auto addCounter = [&](const QString& directory)
+    {
+        if (QFile energy(root + directory + "energy_uj"); !warned && energy.exists() && !energy.open(QIODevice::ReadOnly))
+        {
+            qWarning() << "Can't read RAPL energy counter" << energy.fileName() << "power draw will be 0:" << energy.errorString();
+            warned = true;
+        }
+
+        return _sources.add(directory + "energy_uj");
+    };
+
+    // "intel-rapl:N" are packages, "intel-rapl:N:M" their domains. AMD
+    // exposes the same layout, "intel-rapl-mmio" duplicates the packages.
+    for (const QString& zone : powercap.entryList({ "intel-rapl:*" }, QDir::Dirs | QDir::NoDotAndDotDot))
+    {
+        if (zone.count(':') != 1) continue;
+
+        const QString directory = powercapPath + zone + '/';
+        const QByteArray name   = readFsAttribute(root + directory + "name");
+
+        // psys and others cover more than a package
+        if (!name.startsWith("package-")) continue;
+
+        // N is the physical package id
+        bool ok = false;
+        const auto package = packages.find(name.mid(8).toLongLong(&ok));
+        if (!ok || package == packages.end()) continue;
+
+        const qsizetype cpuIndex = package->second;
+
+        _zones.push_back({
+            .energy   = addCounter(directory),
+            .range    = readFsAttribute(root + directory + "max_energy_range_uj").toULongLong(),
+            .cpuIndex = cpuIndex,
+            .domain   = -1,
+            .name     = QString::fromLatin1(name),
+        });
+
+        qsizetype domain = 0;
+        for (const QString& subzone : powercap.entryList({ zone + ":*" }, QDir::Dirs | QDir::NoDotAndDotDot))
+        {
+            const QString subdirectory = powercapPath + subzone + '/';
+
+            _zones.push_back({
+                .energy   = addCounter(subdirectory),
+                .range    = readFsAttribute(root + subdirectory + "max_energy_range_uj").toULongLong(),
+                .cpuIndex = cpuIndex,
+                .domain   = domain++,
+                .name     = QString::fromLatin1(readFsAttribute(root + subdirectory + "name")),
+            });
+        }
+    }
+}
+
+void PowerCollector::collect(Data_Cpu& data, const Packages_t& packages, const quint64 generation, const qint64 nowUs)
+{
+    if (!_valid || generation != _generation)
+    {
+        discover(packages);
+        _valid      = true;
+        _generation = generation;
+    }
+
+    for (auto& zone : _zones)
+    {
+        if (zone.cpuIndex >= data.cpus.size()) continue;
+
+        auto& cpu = data.cpus[zone.cpuIndex];
+
+        // Snapshots start out with the topology's domain-less cpus
+        if (zone.domain >= 0 && cpu.domains.size() <= zone.domain)
+            cpu.domains.resize(zone.domain + 1);
+        if (zone.domain >= 0 && cpu.domains[zone.domain].name != zone.name)
+            cpu.domains[zone.domain].name = zone.name;
+
+        float& draw = zone.domain < 0 ? cpu.draw : cpu.domains[zone.domain].draw;
+
+        // An unreadable counter reports 0 instead of a stale draw, and the
+        // next reading it gives is a new baseline
+        bool ok = false;
+        const quint64 energy = _sources.read(zone.energy).trimmed().toULongLong(&ok);
+        if (!ok)
+        {
+            draw          = 0;
+            zone.lastTime = -1;
+            continue;
+        }
+
+        if (zone.lastTime >= 0 && nowUs > zone.lastTime)
+        {
+            // Without a range a smaller value is a reset, not a wrap
+            const quint64 delta = energy >= zone.last ? energy - zone.last
+                                : zone.range > 0      ? zone.range - zone.last + energy
+                                : 0;
+
+            // uJ per us are W
+            draw = static_cast<float>(static_cast<double>(delta) / static_cast<double>(nowUs - zone.lastTime));
+        }
+
+        zone.last     = energy;
+        zone.lastTime = nowUs;
+    }
+}
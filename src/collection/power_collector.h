@@ -0,0 +1,53 @@
+#pragma once
+
+#include <qstring.h>
+#include <vector>
+
+#include "cpu_data.h"
+#include "source_registry.h"
+
+// Power draw from the RAPL energy counters under /sys/class/powercap.
+//
+// Every "package-N" zone and its subzones (core, uncore, dram) count
+// microjoules in energy_uj. Watts are the difference between two ticks over
+// the monotonic time between them, a counter that went backwards wrapped at
+// max_energy_range_uj. Zones are discovered once per topology generation,
+// ticks only pread the open energy_uj files.
+//
+// The counters are readable by root only on most kernels, without access
+// every draw stays 0.
+class PowerCollector
+{
+public:
+    explicit PowerCollector(SourceRegistry& sources);
+
+    // Fills draw of every package and its domains in data, in watts.
+    // generation is the topology generation packages belong to, nowUs a
+    // monotonic timestamp. The first tick only takes a baseline.
+    void collect(Data_Cpu& data, const Packages_t& packages, quint64 generation, qint64 nowUs);
+
+private:
+    using Handle_t = SourceRegistry::Handle_t;
+
+    struct Zone
+    {
+        Handle_t energy;
+        quint64 range = 0; // max_energy_range_uj, 0 if unknown
+
+        qsizetype cpuIndex;
+        qsizetype domain; // in CpuData::domains, -1 for the package
+        QString name;
+
+        quint64 last     = 0;
+        qint64  lastTime = -1; // before the first reading
+    };
+
+    SourceRegistry& _sources;
+
+    bool _valid = false;
+    quint64 _generation = 0;
+
+    std::vector<Zone> _zones;
+
+    void discover(const Packages_t& packages);
+};
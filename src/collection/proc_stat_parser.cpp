@@ -0,0 +1,172 @@
+#include "proc_stat_parser.h"
+
+#include <cstring>
+#include <string_view>
+
+namespace
+{
+struct Cursor
+{
+    const char* p;
+    const char* end;
+
+    void skipSpaces()
+    {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\r'))
+            ++p;
+    }
+
+    void skipToken()
+    {
+        while (p < end && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n')
+            ++p;
+    }
+
+    [[nodiscard]] bool atLineEnd()
+    {
+        skipSpaces();
+        return p >= end || *p == '\n';
+    }
+
+    void nextLine()
+    {
+        const auto* newline = static_cast<const char*>(memchr(p, '\n', end - p));
+        p = newline ? newline + 1 : end;
+    }
+
+    std::string_view key()
+    {
+        skipSpaces();
+        const char* begin = p;
+        while (p < end && *p != ' ' && *p != '\t' && *p != '\n')
+            ++p;
+        return {begin, static_cast<size_t>(p - begin)};
+    }
+
+    // Returns false without touching value if the next token doesn't start
+    // with a digit, the cursor then stays in front of it
+    bool number(quint64& value)
+    {
+        skipSpaces();
+        if (p >= end || static_cast<unsigned char>(*p - '0') >= 10)
+            return false;
+
+        value = 0;
+        while (p < end && static_cast<unsigned char>(*p - '0') < 10)
+            value = value * 10 + (*p++ - '0');
+        return true;
+    }
+
+    // Fills vector with the remaining numbers on the line, reusing its storage.
+    // Tokens that are not numbers count as 0, so the ones after them keep
+    // their position, e.g. the irq number in intr.
+    void numbers(QVector<quint64>& vector)
+    {
+        qsizetype count = 0;
+        while (!atLineEnd())
+        {
+            quint64 value = 0;
+            if (!number(value) || (p < end && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n'))
+            {
+                value = 0;
+                skipToken();
+            }
+
+            if (count < vector.size())
+                vector[count] = value;
+            else
+                vector.push_back(value);
+            ++count;
+        }
+        vector.resize(count);
+    }
+};
+
+void parseStatCpu(Data_Cpu::Stats& stats, Cursor& cursor)
+{
+    // Older kernels report fewer columns, the missing ones stay 0
+    quint64* fields[] = {
+        &stats.user, &stats.nice,    &stats.system, &stats.idle,  &stats.iowait,
+        &stats.irq,  &stats.softirq, &stats.steal,  &stats.guest, &stats.guest_nice,
+    };
+
+    for (quint64* field : fields)
+        if (cursor.atLineEnd() || !cursor.number(*field))
+            break;
+}
+
+// Parses the index of "cpuN", returns false for anything else
+bool parseCpuIndex(const std::string_view key, qsizetype& index)
+{
+    if (key.size() <= 3) return false;
+
+    index = 0;
+    for (const char c : key.substr(3))
+    {
+        if (static_cast<unsigned char>(c - '0') >= 10) return false;
+        index = index * 10 + (c - '0');
+    }
+    return true;
+}
+}
+
+void parseProcStat(const QByteArrayView raw, Data_Cpu& data, const Mappings_t& mappings, const MetricGroups groups)
+{
+    using namespace std::string_view_literals;
+
+    const bool wantsCores      = groups.testFlag(MetricGroup::CoreStats);
+    const bool wantsInterrupts = groups.testFlag(MetricGroup::Interrupts);
+    const bool wantsSoftIrqs   = groups.testFlag(MetricGroup::SoftIrqs);
+
+    auto& global = data.globalStats;
+    Cursor cursor { raw.data(), raw.data() + raw.size() };
+
+    while (cursor.p < cursor.end)
+    {
+        const std::string_view key = cursor.key();
+
+        if (key.starts_with("cpu"sv))
+        {
+            if (!wantsCores)
+            {
+                cursor.nextLine();
+                continue;
+            }
+
+            qsizetype index = 0;
+
+            if (key.size() == 3) // global cpu stats
+                parseStatCpu(global.totalCpuStats, cursor);
+            else if (parseCpuIndex(key, index))
+            {
+                if (const auto it = mappings.find(index); it != mappings.end())
+                {
+                    auto [cpuIndex, coreIndex] = it->second;
+                    parseStatCpu(data.cpus[cpuIndex].cores[coreIndex].stats, cursor);
+                }
+            }
+        }
+        else if (key == "softirq"sv)
+        {
+            if (wantsSoftIrqs)
+                cursor.numbers(global.softIrqs);
+        }
+        else if (wantsInterrupts)
+        {
+            if (key == "intr"sv) // interrupts
+                cursor.numbers(global.interrupts);
+            else if (key == "ctxt"sv) // context switches
+                cursor.number(global.contextSwitches);
+            else if (key == "btime"sv) // boot time
+                cursor.number(global.bootTime);
+            else if (key == "processes"sv) // total forks
+                cursor.number(global.processes);
+            else if (key == "procs_running"sv)
+                cursor.number(global.procsRunning);
+            else if (key == "procs_blocked"sv)
+                cursor.number(global.procsBlocked);
+        }
+
+        cursor.nextLine();
+    }
+}
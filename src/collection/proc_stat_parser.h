@@ -0,0 +1,13 @@
+#pragma once
+
+#include <qbytearrayview.h>
+
+#include "cpu_data.h"
+#include "../enums.h"
+
+// Tokenizes the content of /proc/stat in place, straight into data. Cpu lines
+// are routed to the cores through mappings, cpus missing from mappings are
+// skipped. Nothing is allocated apart from growing the interrupt and softirq
+// vectors the first time they are filled. Lines belonging to groups that are
+// not requested are skipped without being tokenized.
+void parseProcStat(QByteArrayView raw, Data_Cpu& data, const Mappings_t& mappings, MetricGroups groups = MetricGroup::All);
@@ -0,0 +1,150 @@
+#include "source_registry.h"
+
+#include <qdebug.h>
+#include <qlogging.h>
+
+#include <cerrno>
+#include <cstring>
+#include <utility>
+#include <fcntl.h>
+#include <unistd.h>
+
+static constexpr size_t initialBufferSize = 4096;
+
+SourceRegistry::SourceRegistry(QString root)
+: _root(std::move(root))
+{}
+
+SourceRegistry::~SourceRegistry()
+{
+    for (auto& source : _sources)
+        close(source);
+}
+
+const QString& SourceRegistry::root() const
+{
+    return _root;
+}
+
+SourceRegistry::Handle_t SourceRegistry::add(const QString& path)
+{
+    if (const auto it = _handles.find(path); it != _handles.end())
+        return it->second;
+
+    const Handle_t handle = static_cast<Handle_t>(_sources.size());
+
+    auto& source = _sources.emplace_back();
+    source.path = (_root + path).toLocal8Bit();
+
+    _handles.insert({path, handle});
+    return handle;
+}
+
+QByteArrayView SourceRegistry::read(const Handle_t handle)
+{
+    Source& source = _sources.at(handle);
+
+    if (source.fd < 0 && (source.missing || !open(source)))
+        return {};
+
+    // Two attempts, the second one after reopening a file that vanished
+    for (int attempt = 0; attempt < 2; ++attempt)
+    {
+        size_t used  = 0;
+        int    error = 0;
+
+        for (;;)
+        {
+            if (used == source.buffer.size())
+                source.buffer.resize(source.buffer.size() * 2);
+
+            const size_t space = source.buffer.size() - used;
+            const ssize_t n = ::pread(source.fd, source.buffer.data() + used, space, static_cast<off_t>(used));
+            ++_syscalls;
+
+            if (n < 0)
+            {
+                if (errno == EINTR) continue;
+                error = errno;
+                break;
+            }
+
+            used += n;
+
+            // procfs and sysfs fill the whole buffer unless the end of the file was reached
+            if (static_cast<size_t>(n) < space)
+            {
+                source.failing = false;
+                return {source.buffer.data(), static_cast<qsizetype>(used)};
+            }
+        }
+
+        close(source);
+
+        // EIO, EAGAIN, ENODATA and friends pass, drivers return them while
+        // the device is busy. The file is opened again on the next read and
+        // the warning waits for a read that succeeded in between.
+        if (error != ENOENT && error != ENODEV)
+        {
+            if (!std::exchange(source.failing, true))
+                qWarning() << "Failed to read" << source.path << ":" << strerror(error);
+            return {};
+        }
+
+        if (!open(source))
+            return {};
+    }
+
+    return {};
+}
+
+void SourceRegistry::retryMissing()
+{
+    for (auto& source : _sources)
+        source.missing = false;
+}
+
+void SourceRegistry::reset(const Handle_t handle)
+{
+    Source& source = _sources.at(handle);
+
+    close(source);
+    source.missing = false;
+    source.failing = false;
+}
+
+void SourceRegistry::beginTick()
+{
+    _syscalls = 0;
+}
+
+quint64 SourceRegistry::syscalls() const
+{
+    return _syscalls;
+}
+
+bool SourceRegistry::open(Source& source)
+{
+    source.fd = ::open(source.path.constData(), O_RDONLY | O_CLOEXEC);
+    ++_syscalls;
+
+    if (source.fd < 0)
+    {
+        source.missing = true;
+        return false;
+    }
+
+    if (source.buffer.empty())
+        source.buffer.resize(initialBufferSize);
+
+    return true;
+}
+
+void SourceRegistry::close(Source& source)
+{
+    if (source.fd < 0) return;
+
+    ::close(source.fd);
+    ++_syscalls;
+    source.fd = -1;
+}
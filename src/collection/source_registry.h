@@ -0,0 +1,72 @@
+#pragma once
+
+#include <qbytearrayview.h>
+#include <qstring.h>
+#include <qtypes.h>
+
+#include <unordered_map>
+#include <vector>
+
+// Keeps procfs/sysfs files open between ticks. Every read is a pread() at
+// offset 0 into a buffer owned by the source, so a tick costs one syscall per
+// file instead of open/read/close plus a QFile.
+class SourceRegistry
+{
+public:
+    using Handle_t = qsizetype;
+
+    // root is prepended to every path, empty means the live system
+    explicit SourceRegistry(QString root = {});
+    ~SourceRegistry();
+
+    SourceRegistry(const SourceRegistry&) = delete;
+    SourceRegistry& operator=(const SourceRegistry&) = delete;
+
+    [[nodiscard]] const QString& root() const;
+
+    // Registers a path and returns its handle, the file is opened on first read.
+    // Registering the same path twice returns the same handle.
+    Handle_t add(const QString& path);
+
+    // Returns the complete content of the file. The view stays valid until the
+    // next read of the same handle. Returns an empty view if the file is missing
+    // or the read failed, a failed read is tried again next time.
+    QByteArrayView read(Handle_t handle);
+
+    // Forget that sources were missing so they are opened again on the next
+    // read, e.g. after a CPU got hotplugged.
+    void retryMissing();
+
+    // Closes the file of handle and forgets it was missing, the next read
+    // opens it again. For a single source that went away, e.g. an unplugged
+    // device that may come back under the same path.
+    void reset(Handle_t handle);
+
+    // Resets the syscall counter, call once at the start of every tick
+    void beginTick();
+
+    // open/pread/close calls issued since the last beginTick()
+    [[nodiscard]] quint64 syscalls() const;
+
+private:
+    struct Source
+    {
+        QByteArray path;
+        int fd = -1;
+        // Failed to open, skipped until retryMissing() or reset()
+        bool missing = false;
+        // The last read failed and was warned about
+        bool failing = false;
+        std::vector<char> buffer;
+    };
+
+    QString _root;
+
+    std::vector<Source> _sources;
+    std::unordered_map<QString, Handle_t> _handles;
+
+    quint64 _syscalls = 0;
+
+    bool open(Source& source);
+    void close(Source& source);
+};
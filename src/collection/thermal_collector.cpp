@@ -0,0 +1,249 @@
+#include "thermal_collector.h"
+
+#include <qdebug.h>
+#include <qdir.h>
+#include <qfileinfo.h>
+
+#include <algorithm>
+#include <iterator>
+#include <map>
+#include <utility>
+
+#include "../util/fs_root.h"
+
+static constexpr auto cpuSysPath  = "/sys/devices/system/cpu/";
+static constexpr auto hwmonPath   = "/sys/class/hwmon/";
+static constexpr auto thermalPath = "/sys/class/thermal/";
+
+// Ticks between two listings of the hwmon devices, a driver loaded after
+// discovery shows up within them
+static constexpr qsizetype rescanTicks = 30;
+
+// Entries of directory starting with prefix, ordered by their number so
+// hwmon10 follows hwmon9
+static QStringList numbered(const QString& directory, const QString& prefix)
+{
+    QStringList entries = QDir(directory).entryList({ prefix + '*' }, QDir::Dirs | QDir::NoDotAndDotDot);
+
+    std::ranges::sort(entries, {}, [&prefix](const QString& entry)
+    {
+        return entry.mid(prefix.size()).toInt();
+    });
+
+    return entries;
+}
+
+ThermalCollector::ThermalCollector(SourceRegistry& sources)
+: _sources(sources)
+{}
+
+void ThermalCollector::discover(const Mappings_t& mappings, const Packages_t& packages)
+{
+    _packages.clear();
+    _cores.clear();
+    _hottestCore.clear();
+
+    const QString& root = _sources.root();
+
+    _hwmonDevices   = numbered(root + hwmonPath, "hwmon");
+    _ticksSinceScan = 0;
+
+    // (cpu index, core id) -> the cores in data that are threads of that
+    // physical core
+    std::map<std::pair<qsizetype, qsizetype>, std::vector<qsizetype>> coreThreads;
+
+    for (const auto& [logical, location] : mappings)
+    {
+        const QString topology = root + cpuSysPath + QString("cpu%1/topology/").arg(logical);
+
+        bool coreOk = false;
+        const qsizetype core = readFsAttribute(topology + "core_id").toLongLong(&coreOk);
+
+        if (coreOk)
+            coreThreads[{ location.first, core }].push_back(location.second);
+    }
+
+    const auto nthPackage = [&packages](const qsizetype n) -> std::optional<qsizetype>
+    {
+        if (n >= static_cast<qsizetype>(packages.size())) return std::nullopt;
+        return std::next(packages.begin(), n)->second;
+    };
+
+    const auto hasPackage = [this](const qsizetype cpuIndex)
+    {
+        return std::ranges::any_of(_packages, [cpuIndex](const Sensor& sensor) { return sensor.cpuIndex == cpuIndex; });
+    };
+
+    // coretemp and k10temp register one device per package, in package order
+    qsizetype coretempIndex = 0;
+    qsizetype k10tempIndex  = 0;
+
+    for (const QString& device : _hwmonDevices)
+    {
+        const QString directory = hwmonPath + device + '/';
+        const QByteArray name   = readFsAttribute(root + directory + "name");
+
+        if (name == "coretemp")
+        {
+            std::optional<qsizetype> package;
+            QString packageInput;
+            std::vector<std::pair<qsizetype, QString>> coreInputs;
+
+            for (const QString& file : QDir(root + directory).entryList({ "temp*_label" }, QDir::Files))
+            {
+                const QByteArray label = readFsAttribute(root + directory + file);
+                const QString input    = directory + QString(file).replace("_label", "_input");
+
+                if (label.startsWith("Package id "))
+                {
+                    package      = label.mid(11).toLongLong();
+                    packageInput = input;
+                }
+                else if (label.startsWith("Core "))
+                    coreInputs.emplace_back(label.mid(5).toLongLong(), input);
+            }
+
+            // Without a "Package id" label the devices count in package order
+            std::optional<qsizetype> cpuIndex = nthPackage(coretempIndex++);
+            if (package)
+            {
+                const auto it = packages.find(*package);
+                cpuIndex = it != packages.end() ? std::optional(it->second) : std::nullopt;
+            }
+
+            if (!cpuIndex) continue;
+
+            if (!packageInput.isEmpty())
+                _packages.push_back({ _sources.add(packageInput), directory, *cpuIndex, {} });
+
+            for (const auto& [coreId, input] : coreInputs)
+                if (const auto threads = coreThreads.find({ *cpuIndex, coreId }); threads != coreThreads.end())
+                    _cores.push_back({ _sources.add(input), directory, *cpuIndex, threads->second });
+
+            if (packageInput.isEmpty() && !coreInputs.empty())
+                _hottestCore.push_back(*cpuIndex);
+        }
+        else if (name == "k10temp" || name == "zenpower")
+        {
+            // Tctl may carry a fan control offset, Tdie is the die itself
+            QString input;
+            for (const QString& file : QDir(root + directory).entryList({ "temp*_label" }, QDir::Files))
+            {
+                const QByteArray label = readFsAttribute(root + directory + file);
+
+                if (label == "Tdie" || (label == "Tctl" && input.isEmpty()))
+                    input = directory + QString(file).replace("_label", "_input");
+            }
+
+            const auto cpuIndex = nthPackage(k10tempIndex++);
+            if (cpuIndex && !input.isEmpty())
+                _packages.push_back({ _sources.add(input), directory, *cpuIndex, {} });
+        }
+    }
+
+    // Thermal zones only fill in packages that hwmon left out
+    qsizetype zoneIndex = 0;
+
+    for (const QString& zone : numbered(root + thermalPath, "thermal_zone"))
+    {
+        const QString directory = thermalPath + zone + '/';
+        const QByteArray type   = readFsAttribute(root + directory + "type");
+
+        if (type != "x86_pkg_temp" && type != "cpu-thermal" && type != "cpu_thermal") continue;
+
+        const auto cpuIndex = nthPackage(zoneIndex++);
+        if (cpuIndex && !hasPackage(*cpuIndex))
+        {
+            _packages.push_back({ _sources.add(directory + "temp"), directory, *cpuIndex, {} });
+            std::erase(_hottestCore, *cpuIndex);
+        }
+    }
+
+    if (_packages.empty() && _cores.empty() && !mappings.empty())
+        qWarning() << "No cpu temperature sensors found, temperature will be 0";
+}
+
+std::optional<float> ThermalCollector::read(const Sensor& sensor)
+{
+    const QByteArrayView raw = _sources.read(sensor.input);
+
+    bool ok = false;
+    const qlonglong millidegrees = raw.trimmed().toLongLong(&ok);
+
+    if (!ok) return std::nullopt;
+    return static_cast<float>(millidegrees) / 1000;
+}
+
+void ThermalCollector::collect(Data_Cpu& data, const Mappings_t& mappings, const Packages_t& packages, const quint64 generation)
+{
+    if (!_valid || generation != _generation
+        || (++_ticksSinceScan >= rescanTicks && numbered(_sources.root() + hwmonPath, "hwmon") != _hwmonDevices))
+    {
+        discover(mappings, packages);
+        _valid      = true;
+        _generation = generation;
+    }
+    else if (_ticksSinceScan >= rescanTicks)
+        _ticksSinceScan = 0;
+
+    // A sensor that can't be read is opened again next tick, drivers fail
+    // reads while the device is busy. One whose device is gone makes the
+    // next tick discover again.
+    bool lost = false;
+    const auto readOrCheck = [this, &lost](const Sensor& sensor)
+    {
+        const auto temp = read(sensor);
+        if (!temp)
+        {
+            if (QFileInfo::exists(_sources.root() + sensor.directory))
+                _sources.reset(sensor.input);
+            else
+                lost = true;
+        }
+        return temp;
+    };
+
+    for (const auto& sensor : _packages)
+    {
+        if (sensor.cpuIndex >= data.cpus.size()) continue;
+
+        const auto temp = readOrCheck(sensor);
+        if (!temp) continue;
+
+        // Cores without a sensor of their own, e.g. with k10temp, report
+        // the package. Core sensors below overwrite this.
+        auto& cpu = data.cpus[sensor.cpuIndex];
+        cpu.temp = *temp;
+        for (auto& core : cpu.cores)
+            core.temp = *temp;
+    }
+
+    for (const auto& sensor : _cores)
+    {
+        if (sensor.cpuIndex >= data.cpus.size()) continue;
+
+        const auto temp = readOrCheck(sensor);
+        if (!temp) continue;
+
+        auto& cores = data.cpus[sensor.cpuIndex].cores;
+        for (const qsizetype coreIndex : sensor.coreIndexes)
+            if (coreIndex < cores.size())
+                cores[coreIndex].temp = *temp;
+    }
+
+    for (const qsizetype cpuIndex : _hottestCore)
+    {
+        if (cpuIndex >= data.cpus.size()) continue;
+
+        auto& cpu = data.cpus[cpuIndex];
+        cpu.temp = 0;
+        for (const auto& core : cpu.cores)
+            cpu.temp = std::max(cpu.temp, core.temp);
+    }
+
+    if (lost)
+    {
+        _valid = false;
+        _sources.retryMissing();
+    }
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <qstring.h>
+#include <qstringlist.h>
+#include <optional>
+#include <vector>
+
+#include "cpu_data.h"
+#include "source_registry.h"
+
+// Package and core temperatures from hwmon, with thermal zones as fallback.
+//
+// Sensors are discovered once: coretemp labels its inputs "Package id N" and
+// "Core N", k10temp has one Tctl/Tdie per package and nothing per core, and
+// x86_pkg_temp or cpu-thermal zones stand in where neither driver is loaded.
+// Ticks then only pread the temp*_input files that are already open.
+// Discovery runs again when the cpu topology changes, a sensor directory
+// disappears, e.g. after a driver reload, or a hwmon device appears.
+class ThermalCollector
+{
+public:
+    explicit ThermalCollector(SourceRegistry& sources);
+
+    // Fills temp of every package and core in data, in degrees Celsius.
+    // generation is the topology generation mappings and packages belong to.
+    void collect(Data_Cpu& data, const Mappings_t& mappings, const Packages_t& packages, quint64 generation);
+
+private:
+    using Handle_t = SourceRegistry::Handle_t;
+
+    struct Sensor
+    {
+        Handle_t input;
+        QString directory; // checked when the input can't be read
+
+        qsizetype cpuIndex;
+        // Cores in data sharing the physical core, one per thread
+        std::vector<qsizetype> coreIndexes;
+    };
+
+    SourceRegistry& _sources;
+
+    bool _valid = false;
+    quint64 _generation = 0;
+
+    // hwmon devices the last discovery saw, listed again every few ticks
+    QStringList _hwmonDevices;
+    qsizetype _ticksSinceScan = 0;
+
+    std::vector<Sensor> _packages;
+    std::vector<Sensor> _cores;
+
+    // Packages with core sensors only, they report their hottest core
+    std::vector<qsizetype> _hottestCore;
+
+    void discover(const Mappings_t& mappings, const Packages_t& packages);
+
+    // Degrees Celsius, nothing if the sensor couldn't be read
+    [[nodiscard]] std::optional<float> read(const Sensor& sensor);
+};
@@ -1,7 +1,29 @@
 #pragma once
 
+#include <qflags.h>
+
 enum class FilterMode
 {
     Inclusive,
     Exclusive
-};
\ No newline at end of file
+};
+
+// Groups of cpu metrics a consumer can subscribe to. Only the collection
+// stages that at least one subscriber needs are run.
+enum class MetricGroup
+{
+    None        = 0,
+    LoadAvg     = 1 << 0, // /proc/loadavg
+    CoreStats   = 1 << 1, // per-core time counters from /proc/stat
+    Frequency   = 1 << 2, // cpufreq min/max/current
+    CpuInfo     = 1 << 3, // names and entries from /proc/cpuinfo
+    Interrupts  = 1 << 4, // "intr" line and global counters of /proc/stat
+    SoftIrqs    = 1 << 5, // "softirq" line of /proc/stat
+    Temperature = 1 << 6, // hwmon and thermal zones
+    Power       = 1 << 7, // RAPL energy counters from powercap
+
+    All = LoadAvg | CoreStats | Frequency | CpuInfo | Interrupts | SoftIrqs | Temperature | Power
+};
+
+Q_DECLARE_FLAGS(MetricGroups, MetricGroup)
+Q_DECLARE_OPERATORS_FOR_FLAGS(MetricGroups)
@@ -5,15 +5,37 @@
 #include <qdebug.h>
 #include <qlogging.h>
 
+#include "util/fs_root.h"
+
 namespace hw_monitor {
 
 HardwareManager::HardwareManager(QObject* parent) : QObject(parent)
 {
-    triggerCollect();
+    // Only records paths, nothing is opened or read before the thread runs
+    _worker = new CollectorWorker(_buffer, defaultFsRoot());
+    _worker->moveToThread(&_thread);
+
+    connect(&_thread, &QThread::finished, _worker, &QObject::deleteLater);
+    connect(_worker, &CollectorWorker::published, this, &HardwareManager::onPublished, Qt::QueuedConnection);
 
-    _timer = new QTimer(this);
-    connect(_timer, &QTimer::timeout, this, &HardwareManager::triggerCollect);
-    _timer->start(_sampleRate);
+    _thread.setObjectName("HardwareCollector");
+    _thread.start();
+
+    QMetaObject::invokeMethod(_worker, [worker = _worker, rate = _sampleRate]
+    {
+        worker->start(rate);
+    }, Qt::QueuedConnection);
+}
+
+HardwareManager::~HardwareManager()
+{
+    _thread.quit();
+    _thread.wait();
+}
+
+bool HardwareManager::ready() const
+{
+    return _ready;
 }
 
 int HardwareManager::sampleRate() const
@@ -26,18 +48,103 @@ void HardwareManager::sampleRate(const int sampleRate)
     _sampleRate = qMax(sampleRate, 0);
     emit sampleRateChanged();
 
-    if (_timer)
+    QMetaObject::invokeMethod(_worker, [worker = _worker, rate = _sampleRate]
     {
-        _timer->stop();
-        if (_sampleRate > 0)
-            _timer->start(_sampleRate);
-    }
+        worker->sampleRate(rate);
+    }, Qt::QueuedConnection);
+}
+
+quint64 HardwareManager::syscallsPerTick() const
+{
+    return _worker->syscallsPerTick();
+}
+
+bool HardwareManager::idlePriority() const
+{
+    return _idlePriority;
 }
 
-void HardwareManager::triggerCollect()
+void HardwareManager::idlePriority(const bool enabled)
 {
-    const auto data = CpuCollector::collect(CpuCollector::Options {});
-    emit cpuDataChanged(data);
+    if (_idlePriority == enabled) return;
+    _idlePriority = enabled;
+    emit schedulingChanged();
+
+    QMetaObject::invokeMethod(_worker, [worker = _worker, enabled]
+    {
+        worker->idlePriority(enabled);
+    }, Qt::QueuedConnection);
+}
+
+QList<int> HardwareManager::affinity() const
+{
+    return _affinity;
+}
+
+void HardwareManager::affinity(const QList<int>& cpus)
+{
+    if (_affinity == cpus) return;
+    _affinity = cpus;
+    emit schedulingChanged();
+
+    QMetaObject::invokeMethod(_worker, [worker = _worker, cpus]
+    {
+        worker->affinity(cpus);
+    }, Qt::QueuedConnection);
+}
+
+void HardwareManager::subscribe(QObject* consumer, const MetricGroups groups)
+{
+    if (!_subscriptions.contains(consumer))
+        connect(consumer, &QObject::destroyed, this, [this, consumer]
+        {
+            unsubscribe(consumer);
+        });
+
+    _subscriptions.insert(consumer, groups);
+    updateGroups();
+}
+
+void HardwareManager::unsubscribe(QObject* consumer)
+{
+    if (!_subscriptions.remove(consumer)) return;
+
+    disconnect(consumer, &QObject::destroyed, this, nullptr);
+    updateGroups();
+}
+
+MetricGroups HardwareManager::subscribedGroups() const
+{
+    return _subscribedGroups;
+}
+
+void HardwareManager::updateGroups()
+{
+    MetricGroups groups = MetricGroup::None;
+    for (const auto subscription : std::as_const(_subscriptions))
+        groups |= subscription;
+
+    if (groups == _subscribedGroups) return;
+    _subscribedGroups = groups;
+
+    QMetaObject::invokeMethod(_worker, [worker = _worker, groups]
+    {
+        worker->groups(groups);
+    }, Qt::QueuedConnection);
+}
+
+void HardwareManager::onPublished()
+{
+    // Several ticks may have been published since, only the newest one counts
+    if (!_buffer.update()) return;
+
+    emit cpuDataChanged(_buffer.front());
     emit collect();
+
+    if (!_ready)
+    {
+        _ready = true;
+        emit readyChanged();
+    }
 }
 }
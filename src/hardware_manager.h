@@ -1,41 +1,87 @@
 #pragma once
 
 #include <qqmlintegration.h>
+#include <QHash>
+#include <QThread>
 #include <QTimer>
 #include <qtmetamacros.h>
 
-#include "collection/cpu_collector.h"
+#include "collection/collector_worker.h"
 #include "collection/cpu_data.h"
+#include "enums.h"
+#include "util/triple_buffer.h"
 
 namespace hw_monitor {
 
 class HardwareManager : public QObject
 {
     Q_OBJECT
+    Q_PROPERTY(bool ready READ ready NOTIFY readyChanged);
     Q_PROPERTY(int sampleRate READ sampleRate WRITE sampleRate NOTIFY sampleRateChanged);
+    Q_PROPERTY(quint64 syscallsPerTick READ syscallsPerTick NOTIFY collect);
+    Q_PROPERTY(bool idlePriority READ idlePriority WRITE idlePriority NOTIFY schedulingChanged);
+    Q_PROPERTY(QList<int> affinity READ affinity WRITE affinity NOTIFY schedulingChanged);
     QML_SINGLETON;
     QML_NAMED_ELEMENT(HardwareManager);
 
 public:
+    // Returns right away, discovery and collection run on the collector thread
     explicit HardwareManager(QObject *parent = nullptr);
+    ~HardwareManager() override;
+
+    // The first snapshot arrived, collection starts with the first subscriber
+    [[nodiscard]] bool ready() const;
 
     [[nodiscard]] int sampleRate() const;
 
     void sampleRate(int sampleRate);
 
+    // Syscalls issued by the last collection, to measure collector overhead
+    [[nodiscard]] quint64 syscallsPerTick() const;
+
+    [[nodiscard]] bool idlePriority() const;
+    void idlePriority(bool enabled);
+
+    [[nodiscard]] QList<int> affinity() const;
+    void affinity(const QList<int>& cpus);
+
+    // Registers the metric groups consumer needs, replacing its previous
+    // subscription. Ends when consumer is destroyed or unsubscribes.
+    // Collection only runs the stages someone subscribed to and stops
+    // entirely while there are no subscribers.
+    void subscribe(QObject* consumer, MetricGroups groups);
+    void unsubscribe(QObject* consumer);
+
+    [[nodiscard]] MetricGroups subscribedGroups() const;
+
 signals:
+    void readyChanged();
     void sampleRateChanged();
+    void schedulingChanged();
     void collect();
 
-    void cpuDataChanged(const Data_Cpu& data);
+    void cpuDataChanged(const Snapshot_Cpu& data);
 
 private slots:
-    void triggerCollect();
+    void onPublished();
 
 private:
+    bool _ready = false;
+
     // In milliseconds
     int _sampleRate = 2000;
 
-    QTimer *_timer = nullptr;
+    bool _idlePriority = false;
+    QList<int> _affinity;
+
+    QHash<QObject*, MetricGroups> _subscriptions;
+    MetricGroups _subscribedGroups = MetricGroup::None;
+
+    void updateGroups();
+
+    // Collection runs on _thread, snapshots come back through _buffer
+    CollectorWorker::Buffer_t _buffer;
+    QThread _thread;
+    CollectorWorker* _worker = nullptr;
 };
-}
\ No newline at end of file
+}
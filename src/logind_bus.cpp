@@ -0,0 +1,204 @@
+#include "logind_bus.h"
+
+#ifdef ENABLE_LOGIND
+
+#include <qdebug.h>
+
+#if defined(HAVE_LIBSYSTEMD)
+# include <systemd/sd-bus.h>
+#elif defined(HAVE_LIBELOGIND)
+# include <elogind/sd-bus.h>
+#elif defined(HAVE_BASU)
+# include <basu/sd-bus.h>
+#else
+# error "No dbus provider found"
+#endif
+
+#include <poll.h>
+#include <time.h>
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <utility>
+
+namespace hw_monitor
+{
+static constexpr auto logindService   = "org.freedesktop.login1";
+static constexpr auto sessionPath     = "/org/freedesktop/login1/session/auto";
+static constexpr auto sessionIface    = "org.freedesktop.login1.Session";
+
+LogindBus::LogindBus(const QString& address, QObject* parent)
+: QObject(parent)
+, _address(address)
+{
+    _timeout.setSingleShot(true);
+    connect(&_timeout, &QTimer::timeout, this, &LogindBus::process);
+
+    open();
+}
+
+LogindBus::~LogindBus()
+{
+    // Sends what is still queued, the last write of a drag included
+    if (_bus)
+        sd_bus_flush_close_unref(_bus);
+}
+
+bool LogindBus::connected() const
+{
+    return _bus != nullptr;
+}
+
+bool LogindBus::open()
+{
+    int r;
+
+    if (_address.isEmpty())
+        r = sd_bus_open_system(&_bus);
+
+    else if (_address == "session")
+        r = sd_bus_open_user(&_bus);
+
+    else
+    {
+        r = sd_bus_new(&_bus);
+        if (r >= 0) r = sd_bus_set_address(_bus, _address.toUtf8().constData());
+        if (r >= 0) r = sd_bus_set_bus_client(_bus, 1);
+        if (r >= 0) r = sd_bus_start(_bus);
+    }
+
+    if (r < 0)
+    {
+        qWarning() << "Can't connect to bus" << (_address.isEmpty() ? "system" : _address) << strerror(-r);
+        _bus = sd_bus_unref(_bus);
+        return false;
+    }
+
+    const int fd = sd_bus_get_fd(_bus);
+
+    _readNotifier  = std::make_unique<QSocketNotifier>(fd, QSocketNotifier::Read);
+    _writeNotifier = std::make_unique<QSocketNotifier>(fd, QSocketNotifier::Write);
+
+    connect(_readNotifier.get(),  &QSocketNotifier::activated, this, &LogindBus::process);
+    connect(_writeNotifier.get(), &QSocketNotifier::activated, this, &LogindBus::process);
+
+    rearm();
+    return true;
+}
+
+void LogindBus::close(const QString& reason)
+{
+    // Reached from process(), which may run inside activated() of either
+    // notifier, so they can't be deleted right here
+    for (QSocketNotifier* notifier : { _readNotifier.release(), _writeNotifier.release() })
+        if (notifier)
+        {
+            notifier->setEnabled(false);
+            notifier->deleteLater();
+        }
+
+    _timeout.stop();
+
+    _bus = sd_bus_unref(_bus);
+
+    // Their replies will never come
+    const auto pending = std::exchange(_pending, {});
+    for (const auto& [className, id] : pending)
+        emit failed(className, id, reason);
+}
+
+void LogindBus::setBrightness(const QString& className, const QString& id, const quint32 value)
+{
+    if (!_bus && !open())
+    {
+        emit failed(className, id, "Not connected to the bus");
+        return;
+    }
+
+    sd_bus_message* call = nullptr;
+    uint64_t cookie = 0;
+
+    int r = sd_bus_message_new_method_call(_bus, &call, logindService, sessionPath, sessionIface, "SetBrightness");
+    if (r >= 0) r = sd_bus_message_append(call, "ssu", className.toUtf8().constData(), id.toUtf8().constData(), value);
+
+    // Floating slot, the bus drops it after the reply. Replies are matched
+    // to the call by cookie, so nothing needs to outlive the bus.
+    if (r >= 0) r = sd_bus_call_async(_bus, nullptr, call, &LogindBus::onReply, this, 0);
+    if (r >= 0) r = sd_bus_message_get_cookie(call, &cookie);
+
+    sd_bus_message_unref(call);
+
+    if (r < 0)
+    {
+        emit failed(className, id, strerror(-r));
+        return;
+    }
+
+    _pending.insert(cookie, { className, id });
+
+    // The call sits in the write queue until the fd is writable
+    rearm();
+}
+
+void LogindBus::process()
+{
+    if (!_bus) return;
+
+    int r;
+    while ((r = sd_bus_process(_bus, nullptr)) > 0) {}
+
+    if (r < 0)
+    {
+        qWarning() << "Lost the bus connection:" << strerror(-r);
+        close(strerror(-r));
+        return;
+    }
+
+    rearm();
+}
+
+void LogindBus::rearm()
+{
+    if (!_bus) return;
+
+    const int events = sd_bus_get_events(_bus);
+    _readNotifier->setEnabled(events & POLLIN);
+    _writeNotifier->setEnabled(events & POLLOUT);
+
+    // Absolute CLOCK_MONOTONIC time in us of the next call timeout
+    uint64_t until = 0;
+    if (sd_bus_get_timeout(_bus, &until) < 0 || until == std::numeric_limits<uint64_t>::max())
+    {
+        _timeout.stop();
+        return;
+    }
+
+    timespec now {};
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    const uint64_t nowUs = static_cast<uint64_t>(now.tv_sec) * 1'000'000 + now.tv_nsec / 1000;
+
+    const uint64_t remaining = until > nowUs ? (until - nowUs + 999) / 1000 : 0;
+    _timeout.start(static_cast<int>(std::min<uint64_t>(remaining, std::numeric_limits<int>::max())));
+}
+
+int LogindBus::onReply(sd_bus_message* reply, void* userdata, sd_bus_error*)
+{
+    auto* self = static_cast<LogindBus*>(userdata);
+
+    uint64_t cookie = 0;
+    sd_bus_message_get_reply_cookie(reply, &cookie);
+    const auto [className, id] = self->_pending.take(cookie);
+
+    // Timeouts and disconnects arrive as synthesized error replies as well
+    if (sd_bus_message_is_method_error(reply, nullptr))
+    {
+        const sd_bus_error* error = sd_bus_message_get_error(reply);
+        emit self->failed(className, id, QString::fromUtf8(error->message ? error->message : error->name));
+    }
+
+    return 0;
+}
+}
+
+#endif
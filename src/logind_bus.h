@@ -0,0 +1,78 @@
+#pragma once
+
+#ifdef ENABLE_LOGIND
+
+#include <qhash.h>
+#include <qobject.h>
+#include <qsocketnotifier.h>
+#include <qstring.h>
+#include <qtenvironmentvariables.h>
+#include <qtimer.h>
+
+#include <memory>
+
+struct sd_bus;
+struct sd_bus_error;
+struct sd_bus_message;
+
+namespace hw_monitor {
+
+// Bus the brightness writes go to. Taken from HARDWARE_CONTROLS_BUS: empty
+// (the default) for the system bus, "session" for the user bus or a D-Bus
+// address. Lets the writes run against a logind stand-in, see
+// tests/logind_stub.cpp.
+inline QString defaultBusAddress()
+{
+    return qEnvironmentVariable("HARDWARE_CONTROLS_BUS");
+}
+
+// Long lived connection to logind. Calls are sent without waiting for the
+// reply, the bus fd is watched by the Qt event loop and replies are
+// dispatched from it, so a write never blocks the GUI thread.
+class LogindBus : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit LogindBus(const QString& address = defaultBusAddress(), QObject* parent = nullptr);
+    ~LogindBus() override;
+
+    [[nodiscard]] bool connected() const;
+
+    // Queues SetBrightness(className, id, value) on the caller's session.
+    // A lost connection is reopened on the next call.
+    void setBrightness(const QString& className, const QString& id, quint32 value);
+
+signals:
+    // The call could not be sent or logind replied with an error
+    void failed(const QString& className, const QString& id, const QString& error);
+
+private:
+    struct Pending
+    {
+        QString className;
+        QString id;
+    };
+
+    QString _address;
+    sd_bus* _bus = nullptr;
+
+    std::unique_ptr<QSocketNotifier> _readNotifier;
+    std::unique_ptr<QSocketNotifier> _writeNotifier;
+    QTimer _timeout;
+
+    // Calls awaiting their reply, by cookie
+    QHash<quint64, Pending> _pending;
+
+    bool open();
+    void close(const QString& reason);
+
+    // Runs sd_bus_process() until idle, then watches what the bus waits for
+    void process();
+    void rearm();
+
+    static int onReply(sd_bus_message* reply, void* userdata, sd_bus_error* error);
+};
+}
+
+#endif
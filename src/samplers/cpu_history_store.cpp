@@ -0,0 +1,383 @@
+#include "cpu_history_store.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+// Bucket duration in milliseconds and bucket count: 1 hour, 12 hours, 7 days
+constexpr struct
+{
+    qint64 duration;
+    qsizetype capacity;
+} tierLayout[] = {
+    {  10'000,  360 },
+    {  60'000,  720 },
+    { 600'000, 1008 },
+};
+
+// Copies out.size() elements of a ring laid out row, starting at slot first,
+// in at most two runs
+template<typename T>
+void copyRun(const qreal* row, const qsizetype capacity, const qsizetype first, const std::span<T> out)
+{
+    const auto head = std::min<qsizetype>(capacity - first, static_cast<qsizetype>(out.size()));
+
+    std::copy_n(row + first, head, out.begin());
+    std::copy_n(row, static_cast<qsizetype>(out.size()) - head, out.begin() + head);
+}
+}
+
+CpuHistoryStore::CpuHistoryStore(const qsizetype capacity)
+: _timestamps(capacity)
+{
+    for (const auto& [duration, tierCapacity] : tierLayout)
+        _tiers.emplace_back(duration, tierCapacity, MetricCount);
+
+    relayout(0, _timestamps.capacity());
+}
+
+qsizetype CpuHistoryStore::rows() const
+{
+    return _rows;
+}
+
+void CpuHistoryStore::setRows(const qsizetype rows)
+{
+    if (rows == _rows) return;
+    relayout(rows, _timestamps.capacity());
+}
+
+qsizetype CpuHistoryStore::capacity() const
+{
+    return _timestamps.capacity();
+}
+
+void CpuHistoryStore::setCapacity(const qsizetype capacity)
+{
+    if (std::max<qsizetype>(capacity, 1) == _timestamps.capacity()) return;
+    relayout(_rows, capacity);
+}
+
+qsizetype CpuHistoryStore::size() const
+{
+    return _timestamps.size();
+}
+
+quint64 CpuHistoryStore::sequence() const
+{
+    return _sequence;
+}
+
+qsizetype CpuHistoryStore::indexOf(const quint64 sequence) const
+{
+    const quint64 first = _sequence - _timestamps.size();
+    if (sequence <= first) return 0;
+
+    return static_cast<qsizetype>(std::min<quint64>(sequence - first, _timestamps.size()));
+}
+
+CpuHistoryStore::Input& CpuHistoryStore::input()
+{
+    return _input;
+}
+
+void CpuHistoryStore::append(const qint64 timestamp)
+{
+    const qsizetype rows = _rows;
+
+    // Branch free over plain arrays so the compiler can vectorize it. A row
+    // without a previous sample (prevTotal == 0) or whose counters did not
+    // advance reports 0.
+    {
+        const quint64* __restrict total     = _input.total.data();
+        const quint64* __restrict idle      = _input.idle.data();
+        const quint64* __restrict prevTotal = _prevTotal.data();
+        const quint64* __restrict prevIdle  = _prevIdle.data();
+        qreal* __restrict util              = _sample.data() + Utilization * rows;
+
+        for (qsizetype row = 0; row < rows; ++row)
+        {
+            // Per tick deltas are small, 32 bit lanes convert to double in
+            // vector registers where 64 bit ones need AVX-512
+            const auto totalDiff = static_cast<qint32>(total[row] - prevTotal[row]);
+            const auto busyDiff  = totalDiff - static_cast<qint32>(idle[row] - prevIdle[row]);
+
+            // All ones when the row has a usable delta, selects by masking
+            const qint32 valid = -static_cast<qint32>((prevTotal[row] != 0) & (totalDiff > 0));
+
+            util[row] = static_cast<qreal>(busyDiff & valid)
+                      / static_cast<qreal>((totalDiff & valid) | (~valid & 1));
+        }
+    }
+
+    std::ranges::copy(_input.freq, _sample.begin() + Frequency   * rows);
+    std::ranges::copy(_input.temp, _sample.begin() + Temperature * rows);
+    std::ranges::copy(_input.draw, _sample.begin() + PowerDraw   * rows);
+
+    // The swapped in vectors hold stale values but the right sizes
+    std::swap(_prevTotal, _input.total);
+    std::swap(_prevIdle,  _input.idle);
+    std::swap(_freqMin,   _input.freqMin);
+    std::swap(_freqMax,   _input.freqMax);
+
+    commit(timestamp);
+}
+
+void CpuHistoryStore::appendRecord(const qint64 timestamp, const std::span<const qreal> values)
+{
+    if (static_cast<qsizetype>(values.size()) != MetricCount * _rows) return;
+
+    std::ranges::copy(values, _sample.begin());
+    commit(timestamp);
+}
+
+std::span<const qreal> CpuHistoryStore::lastSample() const
+{
+    return _sample;
+}
+
+void CpuHistoryStore::commit(const qint64 timestamp)
+{
+    const qsizetype rows = _rows;
+
+    _timestamps.push(timestamp);
+    ++_sequence;
+
+    const qsizetype capacity = _timestamps.capacity();
+    const qsizetype slot     = _timestamps.slotOf(_timestamps.size() - 1);
+
+    std::array<const qreal*, MetricCount> values {};
+
+    for (qsizetype metric = 0; metric < MetricCount; ++metric)
+    {
+        values[metric] = _sample.data() + metric * rows;
+
+        qreal* out = _columns[metric].data() + slot;
+        for (qsizetype row = 0; row < rows; ++row)
+            out[row * capacity] = values[metric][row];
+    }
+
+    for (auto& tier : _tiers)
+        tier.add(timestamp, values);
+}
+
+void CpuHistoryStore::merge(const CpuHistoryStore& older)
+{
+    // Samples of older strictly before the first one here go in front
+    const qsizetype olderCount = _timestamps.empty() ? older.size() : older.lowerBound(_timestamps.at(0));
+    const qsizetype total      = olderCount + _timestamps.size();
+    const qsizetype stride     = _timestamps.capacity();
+    const qsizetype kept       = std::min(total, stride);
+    const qsizetype skipped    = total - kept;
+    const qsizetype olderRows  = std::min(_rows, older.rows());
+
+    RingBuffer<qint64> timestamps(stride);
+    std::array<std::vector<qreal>, MetricCount> columns;
+    for (auto& column : columns)
+        column.assign(_rows * stride, 0.0);
+
+    for (qsizetype i = 0; i < kept; ++i)
+    {
+        const qsizetype index   = skipped + i;
+        const bool fromOlder    = index < olderCount;
+        const CpuHistoryStore& source = fromOlder ? older : *this;
+        const qsizetype at      = fromOlder ? index : index - olderCount;
+        const qsizetype rows    = fromOlder ? olderRows : _rows;
+
+        timestamps.push(source.timestamp(at));
+
+        for (qsizetype metric = 0; metric < MetricCount; ++metric)
+            for (qsizetype row = 0; row < rows; ++row)
+                columns[metric][row * stride + i] = source.value(static_cast<Metric>(metric), row, at);
+    }
+
+    _timestamps = std::move(timestamps);
+    _columns    = std::move(columns);
+
+    // The samples from older take the numbers before the first one here,
+    // which only needs more numbers than were handed out shortly after start
+    _sequence = std::max<quint64>(_sequence, _timestamps.size());
+
+    for (qsizetype i = 0; i < static_cast<qsizetype>(_tiers.size()); ++i)
+        if (i < static_cast<qsizetype>(older._tiers.size()))
+            _tiers[i].merge(older._tiers[i]);
+}
+
+qreal CpuHistoryStore::value(const Metric metric, const qsizetype row, const qsizetype index) const
+{
+    return _columns[metric][row * _timestamps.capacity() + _timestamps.slotOf(index)];
+}
+
+qreal CpuHistoryStore::latest(const Metric metric, const qsizetype row) const
+{
+    if (_timestamps.empty() || row >= _rows) return 0.0;
+    return value(metric, row, _timestamps.size() - 1);
+}
+
+qint64 CpuHistoryStore::timestamp(const qsizetype index) const
+{
+    return _timestamps.at(index);
+}
+
+void CpuHistoryStore::copy(const Metric metric, const qsizetype row, const qsizetype index, const std::span<qreal> out) const
+{
+    const qsizetype stride = _timestamps.capacity();
+    copyRun(_columns[metric].data() + row * stride, stride, _timestamps.slotOf(index), out);
+}
+
+void CpuHistoryStore::copy(const Metric metric, const qsizetype row, const qsizetype index, const std::span<float> out) const
+{
+    const qsizetype stride = _timestamps.capacity();
+    copyRun(_columns[metric].data() + row * stride, stride, _timestamps.slotOf(index), out);
+}
+
+std::vector<CpuHistoryStore::Bucket> CpuHistoryStore::window(
+    const Metric metric,
+    const qsizetype row,
+    const qint64 span,
+    const qsizetype points) const
+{
+    std::vector<Bucket> window;
+    if (_timestamps.empty() || row >= _rows || points <= 0) return window;
+
+    const qint64 start = _timestamps.last() - span;
+
+    // Candidates are the raw samples (-1) and every tier. Those reaching
+    // back within 10 % of the furthest candidate qualify, among them the
+    // bucket count closest to points wins.
+    const auto tierCount = static_cast<qsizetype>(_tiers.size());
+
+    const auto coverage = [this, span](const qint64 oldest)
+    {
+        return std::clamp(static_cast<qreal>(_timestamps.last() - oldest) / std::max<qint64>(span, 1), 0.0, 1.0);
+    };
+
+    qreal maxCoverage = coverage(_timestamps.at(0));
+    for (const auto& tier : _tiers)
+        if (tier.size() > 0)
+            maxCoverage = std::max(maxCoverage, coverage(tier.time(0)));
+
+    qsizetype best  = -1;
+    qreal bestRatio = std::numeric_limits<qreal>::max();
+
+    for (qsizetype candidate = -1; candidate < tierCount; ++candidate)
+    {
+        qsizetype count;
+        qint64 oldest;
+
+        if (candidate == -1)
+        {
+            count  = _timestamps.size() - lowerBound(start);
+            oldest = _timestamps.at(0);
+        }
+        else
+        {
+            const auto& tier = _tiers[candidate];
+            if (tier.size() == 0) continue;
+
+            count  = tier.size() - tier.lowerBound(start);
+            oldest = tier.time(0);
+        }
+
+        if (coverage(oldest) < maxCoverage * 0.9) continue;
+
+        const qreal ratio = std::abs(std::log(static_cast<qreal>(std::max<qsizetype>(count, 1)) / points));
+        if (ratio < bestRatio)
+        {
+            best      = candidate;
+            bestRatio = ratio;
+        }
+    }
+
+    if (best == -1)
+    {
+        window.reserve(_timestamps.size() - lowerBound(start));
+        for (qsizetype i = lowerBound(start); i < _timestamps.size(); ++i)
+        {
+            const auto v = static_cast<float>(value(metric, row, i));
+            window.push_back({ .time = _timestamps.at(i), .min = v, .max = v, .mean = v });
+        }
+    }
+    else
+    {
+        const auto& tier = _tiers[best];
+
+        window.reserve(tier.size() - tier.lowerBound(start));
+        for (qsizetype i = tier.lowerBound(start); i < tier.size(); ++i)
+            window.push_back(tier.bucket(metric, row, i));
+    }
+
+    return window;
+}
+
+qreal CpuHistoryStore::freqMin(const qsizetype row) const
+{
+    return row < _rows ? _freqMin[row] : 0.0;
+}
+
+qreal CpuHistoryStore::freqMax(const qsizetype row) const
+{
+    return row < _rows ? _freqMax[row] : 0.0;
+}
+
+void CpuHistoryStore::relayout(const qsizetype rows, const qsizetype capacity)
+{
+    // Copy the newest samples that fit into the new layout, oldest first
+    RingBuffer<qint64> timestamps(capacity);
+    const qsizetype kept      = std::min(_timestamps.size(), timestamps.capacity());
+    const qsizetype first     = _timestamps.size() - kept;
+    const qsizetype keptRows  = std::min(rows, _rows);
+    const qsizetype oldStride = _timestamps.capacity();
+    const qsizetype newStride = timestamps.capacity();
+
+    for (qsizetype i = 0; i < kept; ++i)
+        timestamps.push(_timestamps.at(first + i));
+
+    for (auto& column : _columns)
+    {
+        std::vector<qreal> relaid(rows * newStride, 0.0);
+
+        for (qsizetype row = 0; row < keptRows; ++row)
+            for (qsizetype i = 0; i < kept; ++i)
+                relaid[row * newStride + i] = column[row * oldStride + _timestamps.slotOf(first + i)];
+
+        column = std::move(relaid);
+    }
+
+    _timestamps = std::move(timestamps);
+    _rows       = rows;
+
+    for (auto& tier : _tiers)
+        tier.setRows(rows);
+
+    for (auto* vector : { &_prevTotal, &_prevIdle, &_input.total, &_input.idle })
+        vector->resize(rows, 0);
+
+    _sample.resize(MetricCount * rows, 0.0);
+
+    for (auto* vector : { &_freqMin, &_freqMax,
+                          &_input.freq, &_input.freqMin, &_input.freqMax, &_input.temp, &_input.draw })
+        vector->resize(rows, 0.0);
+}
+
+qsizetype CpuHistoryStore::lowerBound(const qint64 time) const
+{
+    qsizetype first = 0;
+    qsizetype count = _timestamps.size();
+
+    while (count > 0)
+    {
+        const qsizetype step = count / 2;
+        if (_timestamps.at(first + step) < time)
+        {
+            first += step + 1;
+            count -= step + 1;
+        }
+        else
+            count = step;
+    }
+
+    return first;
+}
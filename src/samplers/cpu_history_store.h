@@ -0,0 +1,130 @@
+#pragma once
+
+#include <qtypes.h>
+
+#include <array>
+#include <span>
+#include <vector>
+
+#include "../util/ring_buffer.h"
+#include "history_tier.h"
+
+// Column oriented history of every entry of a sampler. Each metric is one
+// contiguous array laid out as rows x capacity, so the history of a single
+// row is contiguous and appending a tick touches every row once. Row 0 is the
+// aggregate, the cores follow.
+//
+// Next to the raw samples every append is folded into downsampled tiers of
+// 10 s, 1 min and 10 min buckets, so long windows stay cheap to keep and to
+// query no matter how many raw samples they span.
+class CpuHistoryStore
+{
+public:
+    enum Metric
+    {
+        Frequency,
+        Temperature,
+        Utilization,
+        PowerDraw,
+
+        MetricCount
+    };
+
+    // Inputs of the next sample, one element per row. Filled by the caller
+    // before append(), utilization is derived from total and idle.
+    struct Input
+    {
+        std::vector<quint64> total;
+        std::vector<quint64> idle;
+        std::vector<qreal>   freq;
+        std::vector<qreal>   freqMin;
+        std::vector<qreal>   freqMax;
+        std::vector<qreal>   temp;
+        std::vector<qreal>   draw;
+    };
+
+    using Bucket = HistoryTier::Bucket;
+
+    explicit CpuHistoryStore(qsizetype capacity = 50);
+
+    [[nodiscard]] qsizetype rows() const;
+    // New rows start with a history of zeros
+    void setRows(qsizetype rows);
+
+    [[nodiscard]] qsizetype capacity() const;
+    // Keeps the newest samples that still fit
+    void setCapacity(qsizetype capacity);
+
+    // Samples currently held
+    [[nodiscard]] qsizetype size() const;
+    // Number of the next sample. Held samples are numbered sequence() - size()
+    // up to sequence() - 1 and keep their number until they are dropped.
+    [[nodiscard]] quint64 sequence() const;
+    // Index of the sample numbered sequence, clamped to the held samples
+    [[nodiscard]] qsizetype indexOf(quint64 sequence) const;
+
+    Input& input();
+
+    // Computes the utilization of all rows in one pass and stores the sample
+    void append(qint64 timestamp);
+
+    // Stores a sample whose values are already known, laid out as
+    // values[metric * rows + row]. Replays persisted history.
+    void appendRecord(qint64 timestamp, std::span<const qreal> values);
+
+    // Values of the last sample in the appendRecord() layout, valid until
+    // the next append or setRows()
+    [[nodiscard]] std::span<const qreal> lastSample() const;
+
+    // Puts the samples and buckets of older that precede this store's in
+    // front of them, keeping the newest that fit. Restores history loaded
+    // in the background into the live store.
+    void merge(const CpuHistoryStore& older);
+
+    // index 0 is the oldest sample
+    [[nodiscard]] qreal value(Metric metric, qsizetype row, qsizetype index) const;
+    [[nodiscard]] qreal latest(Metric metric, qsizetype row) const;
+    [[nodiscard]] qint64 timestamp(qsizetype index) const;
+
+    // The samples of a row from index on into out, oldest first. Copies the
+    // contiguous runs of the ring instead of going through value().
+    void copy(Metric metric, qsizetype row, qsizetype index, std::span<qreal> out) const;
+    void copy(Metric metric, qsizetype row, qsizetype index, std::span<float> out) const;
+
+    // The last span milliseconds of a row, from the raw samples or the tier
+    // whose bucket count comes closest to points. Raw samples are returned
+    // as buckets with min == max == mean. O(points), oldest first.
+    [[nodiscard]] std::vector<Bucket> window(Metric metric, qsizetype row, qint64 span, qsizetype points) const;
+
+    [[nodiscard]] qreal freqMin(qsizetype row) const;
+    [[nodiscard]] qreal freqMax(qsizetype row) const;
+
+private:
+    qsizetype _rows = 0;
+
+    // Owns the ring layout, the metric columns follow its slots
+    RingBuffer<qint64> _timestamps;
+    quint64 _sequence = 0;
+
+    std::array<std::vector<qreal>, MetricCount> _columns;
+
+    std::vector<HistoryTier> _tiers;
+
+    Input _input;
+
+    // Counters of the previous sample
+    std::vector<quint64> _prevTotal;
+    std::vector<quint64> _prevIdle;
+
+    // Values of the sample being stored, [metric * rows + row]
+    std::vector<qreal> _sample;
+
+    std::vector<qreal> _freqMin;
+    std::vector<qreal> _freqMax;
+
+    void relayout(qsizetype rows, qsizetype capacity);
+    void commit(qint64 timestamp);
+
+    // Index of the first raw sample at or after time
+    [[nodiscard]] qsizetype lowerBound(qint64 time) const;
+};
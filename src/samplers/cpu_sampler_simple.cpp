@@ -1,10 +1,29 @@
 #include "cpu_sampler_simple.h"
 
+#include <qdatetime.h>
+#include <qdebug.h>
+#include <qfuture.h>
+#include <qpromise.h>
+#include <qthreadpool.h>
 #include <qqml.h>
 #include <qqmlengine.h>
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
 #include "../hardware_manager.h"
 
+SimpleCpuDataSnapshotModel::SimpleCpuDataSnapshotModel(
+    const CpuHistoryStore* store,
+    const qsizetype row,
+    const qsizetype columns,
+    QObject* parent)
+: QAbstractTableModel(parent)
+, _store(store)
+, _row(row)
+, _columns(columns) {}
+
 QHash<int, QByteArray> SimpleCpuDataSnapshotModel::roleNames() const
 {
     QHash<int, QByteArray> roles;
@@ -12,32 +31,42 @@ QHash<int, QByteArray> SimpleCpuDataSnapshotModel::roleNames() const
     roles[static_cast<int>(Roles::Frequency)]   = "frequency";
     roles[static_cast<int>(Roles::Utilization)] = "utilization";
     roles[static_cast<int>(Roles::PowerDraw)]   = "powerDraw";
+    roles[static_cast<int>(Roles::Time)]        = "time";
     return roles;
 }
 
 int SimpleCpuDataSnapshotModel::rowCount(const QModelIndex& parent) const
 {
-    Q_UNUSED(parent);
-    return static_cast<int>(_snapshots.size());
+    return parent.isValid() ? 0 : static_cast<int>(_visible);
+}
+
+int SimpleCpuDataSnapshotModel::columnCount(const QModelIndex& parent) const
+{
+    return parent.isValid() ? 0 : static_cast<int>(_columns);
 }
 
 QVariant SimpleCpuDataSnapshotModel::data(const QModelIndex& index, int role) const
 {
-    if (!index.isValid() || index.row() < 0 || index.row() >= _snapshots.size())
+    if (!index.isValid() || index.row() < 0 || index.row() >= _visible
+        || index.column() < 0 || index.column() >= _columns)
         return {};
 
-    const SimpleCpuDataSnapshot& s = _snapshots.at(index.row());
+    // Rows announced so far are the newest samples of the store
+    const qsizetype sample = _store->size() - _visible + index.row();
+    const qsizetype row    = _row + index.column();
 
     switch (static_cast<Roles>(role))
     {
     case Roles::Temperature:
-        return s.temp;
+        return _store->value(CpuHistoryStore::Temperature, row, sample);
     case Roles::Frequency:
-        return s.freq;
+        return _store->value(CpuHistoryStore::Frequency, row, sample);
     case Roles::PowerDraw:
-        return s.draw;
+        return _store->value(CpuHistoryStore::PowerDraw, row, sample);
     case Roles::Utilization:
-        return s.util;
+        return _store->value(CpuHistoryStore::Utilization, row, sample);
+    case Roles::Time:
+        return _store->timestamp(sample);
     default:
         return {};
     }
@@ -45,105 +74,384 @@ QVariant SimpleCpuDataSnapshotModel::data(const QModelIndex& index, int role) co
 
 qsizetype SimpleCpuDataSnapshotModel::size() const
 {
-    return _snapshots.size();
+    return _visible;
 }
 
 qsizetype SimpleCpuDataSnapshotModel::maxSize() const
 {
-    return _maxSize;
+    return _store->capacity();
+}
+
+qsizetype SimpleCpuDataSnapshotModel::columns() const
+{
+    return _columns;
+}
+
+void SimpleCpuDataSnapshotModel::columns(const qsizetype columns)
+{
+    if (columns == _columns) return;
+
+    if (columns > _columns)
+    {
+        beginInsertColumns(QModelIndex(), static_cast<int>(_columns), static_cast<int>(columns) - 1);
+        _columns = columns;
+        endInsertColumns();
+    }
+    else
+    {
+        beginRemoveColumns(QModelIndex(), static_cast<int>(columns), static_cast<int>(_columns) - 1);
+        _columns = columns;
+        endRemoveColumns();
+    }
+}
+
+SimpleCpuDataSnapshot SimpleCpuDataSnapshotModel::snapshotAt(const qsizetype row) const
+{
+    const qsizetype sample = _store->size() - _visible + row;
+
+    return {
+        .freq = _store->value(CpuHistoryStore::Frequency,   _row, sample),
+        .temp = _store->value(CpuHistoryStore::Temperature, _row, sample),
+        .util = _store->value(CpuHistoryStore::Utilization, _row, sample),
+        .draw = _store->value(CpuHistoryStore::PowerDraw,   _row, sample),
+    };
 }
 
-void SimpleCpuDataSnapshotModel::maxSize(const qsizetype size)
+void SimpleCpuDataSnapshotModel::flush()
 {
-    if (_maxSize == size) return;
-    _maxSize = size;
+    const quint64 appended = _store->sequence() - _seenSequence;
+    if (appended == 0) return;
+    _seenSequence = _store->sequence();
 
-    // Trim if current size exceeds new max
-    if (_snapshots.size() > _maxSize)
+    const qsizetype inserted = _store->size() - _visible;
+    if (inserted > 0)
     {
-        beginRemoveRows(QModelIndex(), 0, _snapshots.size() - _maxSize - 1);
-        _snapshots.erase(_snapshots.begin(), _snapshots.begin() + (_snapshots.size() - _maxSize));
-        endRemoveRows();
+        beginInsertRows(QModelIndex(), static_cast<int>(_visible), static_cast<int>(_store->size()) - 1);
+        _visible = _store->size();
+        endInsertRows();
     }
+
+    // Overwriting the oldest samples shifted every row
+    if (appended > static_cast<quint64>(inserted))
+        emit dataChanged(index(0, 0), index(static_cast<int>(_visible) - 1, static_cast<int>(_columns) - 1));
+}
+
+void SimpleCpuDataSnapshotModel::beginRelayout()
+{
+    beginResetModel();
+}
+
+void SimpleCpuDataSnapshotModel::endRelayout()
+{
+    _visible      = _store->size();
+    _seenSequence = _store->sequence();
+    endResetModel();
+}
+
+namespace
+{
+// Property names of the per entry metrics, also the history() metric names
+constexpr std::pair<const char*, CpuHistoryStore::Metric> metricProperties[] = {
+    { "frequency",   CpuHistoryStore::Frequency   },
+    { "temperature", CpuHistoryStore::Temperature },
+    { "utilization", CpuHistoryStore::Utilization },
+    { "powerDraw",   CpuHistoryStore::PowerDraw   },
+};
+
+constexpr const char* loadProperties[] = { "load1", "load5", "load15" };
+
+// Moves announced to value when it left the dead-band around it
+bool leavesDeadBand(qreal& announced, const qreal value, const qreal threshold)
+{
+    if (!std::isnan(announced) && std::abs(value - announced) <= threshold)
+        return false;
+
+    announced = value;
+    return true;
+}
+
+qreal announcedOrZero(const qreal value)
+{
+    return std::isnan(value) ? 0.0 : value;
+}
+}
+
+bool cpuMetricFromName(const QString& name, CpuHistoryStore::Metric& metric)
+{
+    const auto it = std::ranges::find_if(metricProperties, [&name](const auto& entry)
+    {
+        return name == QLatin1StringView(entry.first);
+    });
+
+    if (it == std::end(metricProperties)) return false;
+
+    metric = it->second;
+    return true;
+}
+
+SimpleCpuDataCoresModel::SimpleCpuDataCoresModel(const CpuHistoryStore* store, QObject* parent)
+: QAbstractTableModel(parent)
+, _store(store)
+, _history(store, 1, 0, this) {}
+
+QHash<int, QByteArray> SimpleCpuDataCoresModel::roleNames() const
+{
+    QHash<int, QByteArray> roles = QAbstractTableModel::roleNames();
+    roles[static_cast<int>(Roles::Temperature)]  = "temperature";
+    roles[static_cast<int>(Roles::Frequency)]    = "frequency";
+    roles[static_cast<int>(Roles::Utilization)]  = "utilization";
+    roles[static_cast<int>(Roles::PowerDraw)]    = "powerDraw";
+    roles[static_cast<int>(Roles::FrequencyMin)] = "frequencyMin";
+    roles[static_cast<int>(Roles::FrequencyMax)] = "frequencyMax";
+    return roles;
+}
+
+int SimpleCpuDataCoresModel::rowCount(const QModelIndex& parent) const
+{
+    return parent.isValid() ? 0 : static_cast<int>(_cores);
 }
 
-const SimpleCpuDataSnapshot& SimpleCpuDataSnapshotModel::snapshotAt(const qsizetype row) const
+int SimpleCpuDataCoresModel::columnCount(const QModelIndex& parent) const
 {
-    if (row < 0 || row >= _snapshots.size())
-        throw std::runtime_error("Index out of bounds.");
+    return parent.isValid() ? 0 : CpuHistoryStore::MetricCount;
+}
+
+QVariant SimpleCpuDataCoresModel::data(const QModelIndex& index, const int role) const
+{
+    if (!index.isValid() || index.row() < 0 || index.row() >= _cores)
+        return {};
+
+    const qsizetype core = index.row();
+    const auto announced = [this, core](const CpuHistoryStore::Metric metric)
+    {
+        return announcedOrZero(_announced[core * CpuHistoryStore::MetricCount + metric]);
+    };
+
+    if (role == Qt::DisplayRole)
+    {
+        if (index.column() < 0 || index.column() >= CpuHistoryStore::MetricCount)
+            return {};
+
+        return announced(static_cast<CpuHistoryStore::Metric>(index.column()));
+    }
+
+    switch (static_cast<Roles>(role))
+    {
+    case Roles::Temperature:
+        return announced(CpuHistoryStore::Temperature);
+    case Roles::Frequency:
+        return announced(CpuHistoryStore::Frequency);
+    case Roles::Utilization:
+        return announced(CpuHistoryStore::Utilization);
+    case Roles::PowerDraw:
+        return announced(CpuHistoryStore::PowerDraw);
+    case Roles::FrequencyMin:
+        return _store->freqMin(core + 1);
+    case Roles::FrequencyMax:
+        return _store->freqMax(core + 1);
+    default:
+        return {};
+    }
+}
 
-    return _snapshots.at(row);
+SimpleCpuDataSnapshotModel* SimpleCpuDataCoresModel::history()
+{
+    return &_history;
 }
 
-const SimpleCpuDataSnapshot& SimpleCpuDataSnapshotModel::appendSnapshot(
-    const SimpleCpuDataSnapshot& s)
+void SimpleCpuDataCoresModel::update(const CpuThresholds_t& thresholds)
 {
-    while (_snapshots.size() >= _maxSize && _maxSize > 0)
+    static constexpr Roles metricRoles[] = {
+        Roles::Frequency,
+        Roles::Temperature,
+        Roles::Utilization,
+        Roles::PowerDraw,
+    };
+
+    // Store row 0 is the aggregate
+    const qsizetype cores = std::max<qsizetype>(_store->rows() - 1, 0);
+    if (cores > _cores)
+    {
+        beginInsertRows(QModelIndex(), static_cast<int>(_cores), static_cast<int>(cores) - 1);
+        _announced.resize(cores * CpuHistoryStore::MetricCount, std::numeric_limits<qreal>::quiet_NaN());
+        _cores = cores;
+        endInsertRows();
+    }
+
+    _history.columns(_cores);
+    _history.flush();
+
+    qsizetype first = _cores;
+    qsizetype last  = -1;
+    std::array<bool, CpuHistoryStore::MetricCount> changed {};
+
+    for (qsizetype core = 0; core < _cores; ++core)
     {
-        beginRemoveRows(QModelIndex(), 0, 0);
-        _snapshots.pop_front();
-        endRemoveRows();
+        for (qsizetype metric = 0; metric < CpuHistoryStore::MetricCount; ++metric)
+        {
+            const qreal latest = _store->latest(static_cast<CpuHistoryStore::Metric>(metric), core + 1);
+
+            if (leavesDeadBand(_announced[core * CpuHistoryStore::MetricCount + metric], latest, thresholds[metric]))
+            {
+                first = std::min(first, core);
+                last  = std::max(last, core);
+                changed[metric] = true;
+            }
+        }
     }
 
-    const int row = _snapshots.size();
-    beginInsertRows(QModelIndex(), row, row);
-    _snapshots.append(s);
-    endInsertRows();
+    if (last < 0) return;
+
+    QList<int> roles { Qt::DisplayRole };
+    for (qsizetype metric = 0; metric < CpuHistoryStore::MetricCount; ++metric)
+        if (changed[metric])
+            roles.append(static_cast<int>(metricRoles[metric]));
 
-    return _snapshots.last();
+    emit dataChanged(
+        index(static_cast<int>(first), 0),
+        index(static_cast<int>(last), CpuHistoryStore::MetricCount - 1),
+        roles);
 }
 
-SimpleCpuDataEntryBase::SimpleCpuDataEntryBase(QObject* parent)
-: QObject(parent) {}
+SimpleCpuDataEntryBase::SimpleCpuDataEntryBase(
+    CpuHistoryStore* store,
+    const qsizetype row,
+    QObject* parent)
+: QObject(parent)
+, _store(store)
+, _row(row)
+, _snapshots(store, row)
+{
+    _published.fill(std::numeric_limits<qreal>::quiet_NaN());
+}
 
-qreal SimpleCpuDataEntryBase::frequencyMin() const { return  _freqMin / 1000; }
-qreal SimpleCpuDataEntryBase::frequencyMax() const { return  _freqMax / 1000; }
-qreal SimpleCpuDataEntryBase::frequency()    const
+qreal SimpleCpuDataEntryBase::frequencyMin() const { return _store->freqMin(_row); }
+qreal SimpleCpuDataEntryBase::frequencyMax() const { return _store->freqMax(_row); }
+
+qreal SimpleCpuDataEntryBase::frequency() const
 {
-    return _latestSnapshot ? _latestSnapshot->freq / 1000: 0.0;
+    return announcedOrZero(_published[CpuHistoryStore::Frequency]);
 }
+
 qreal SimpleCpuDataEntryBase::temperature() const
 {
-    return _latestSnapshot ? _latestSnapshot->temp : 0.0;
+    return announcedOrZero(_published[CpuHistoryStore::Temperature]);
 }
+
 qreal SimpleCpuDataEntryBase::utilization() const
 {
-    return _latestSnapshot ? _latestSnapshot->util : 0.0;
+    return announcedOrZero(_published[CpuHistoryStore::Utilization]);
 }
 
 qreal SimpleCpuDataEntryBase::powerDraw() const
 {
-    return _latestSnapshot ? _latestSnapshot->draw : 0.0;
+    return announcedOrZero(_published[CpuHistoryStore::PowerDraw]);
+}
+
+void SimpleCpuDataEntryBase::publish(const CpuThresholds_t& thresholds)
+{
+    static constexpr void (SimpleCpuDataEntryBase::*signals[])() = {
+        &SimpleCpuDataEntryBase::frequencyChanged,
+        &SimpleCpuDataEntryBase::temperatureChanged,
+        &SimpleCpuDataEntryBase::utilizationChanged,
+        &SimpleCpuDataEntryBase::powerDrawChanged,
+    };
+
+    for (qsizetype metric = 0; metric < CpuHistoryStore::MetricCount; ++metric)
+    {
+        const qreal latest = _store->latest(static_cast<CpuHistoryStore::Metric>(metric), _row);
+
+        if (leavesDeadBand(_published[metric], latest, thresholds[metric]))
+            emit (this->*signals[metric])();
+    }
+}
+
+QVariantList SimpleCpuDataEntryBase::history(const QString& metric, const int seconds, const int points) const
+{
+    CpuHistoryStore::Metric historyMetric;
+    if (!cpuMetricFromName(metric, historyMetric))
+    {
+        qWarning() << "Unknown history metric" << metric;
+        return {};
+    }
+
+    const auto buckets = _store->window(historyMetric, _row, qint64(seconds) * 1000, points);
+
+    QVariantList history;
+    history.reserve(static_cast<qsizetype>(buckets.size()));
+
+    for (const auto& bucket : buckets)
+    {
+        history.append(QVariantMap {
+            { "time", bucket.time },
+            { "min",  bucket.min  },
+            { "max",  bucket.max  },
+            { "mean", bucket.mean },
+        });
+    }
+
+    return history;
 }
 
-void SimpleCpuDataEntryBase::importData(
-    const Data_Cpu::Entry& entry,
-    const qreal draw)
+QList<qreal> SimpleCpuDataEntryBase::series(const QString& metric, const qint64 since) const
 {
-    _freqMin = entry.freqMin;
-    _freqMax = entry.freqMax;
+    CpuHistoryStore::Metric seriesMetric;
+    if (!cpuMetricFromName(metric, seriesMetric))
+    {
+        qWarning() << "Unknown history metric" << metric;
+        return {};
+    }
 
-    const quint64 newTotal = entry.stats.total();
-    const quint64 newIdle  = entry.stats.idle;
+    const qsizetype from = since < 0 ? 0 : _store->indexOf(since);
 
-    SimpleCpuDataSnapshot snap;
-    snap.freq = entry.freqNow;
-    snap.temp = entry.temp;
-    snap.util = 0.0;
-    snap.draw = draw;
+    QList<qreal> series(_store->size() - from);
+    _store->copy(seriesMetric, _row, from, std::span(series.data(), series.size()));
 
-    if (_total != 0)
+    return series;
+}
+
+QByteArray SimpleCpuDataEntryBase::seriesBuffer(const QString& metric, const qint64 since) const
+{
+    CpuHistoryStore::Metric seriesMetric;
+    if (!cpuMetricFromName(metric, seriesMetric))
     {
-        const auto totalDiff = newTotal - _total;
-        const auto idleDiff  = newIdle  - _idle;
-        snap.util = static_cast<qreal>(totalDiff - idleDiff) / static_cast<float>(totalDiff);
+        qWarning() << "Unknown history metric" << metric;
+        return {};
     }
 
-    _total = newTotal;
-    _idle  = newIdle;
+    const qsizetype from  = since < 0 ? 0 : _store->indexOf(since);
+    const qsizetype count = _store->size() - from;
+
+    QByteArray buffer(count * qsizetype(sizeof(float)), Qt::Uninitialized);
+    _store->copy(seriesMetric, _row, from, std::span(reinterpret_cast<float*>(buffer.data()), count));
+
+    return buffer;
+}
+
+QList<qint64> SimpleCpuDataEntryBase::seriesTimes(const qint64 since) const
+{
+    const qsizetype from = since < 0 ? 0 : _store->indexOf(since);
+
+    QList<qint64> times;
+    times.reserve(_store->size() - from);
+
+    for (qsizetype i = from; i < _store->size(); ++i)
+        times.append(_store->timestamp(i));
+
+    return times;
+}
+
+qint64 SimpleCpuDataEntryBase::seriesEnd() const
+{
+    return static_cast<qint64>(_store->sequence());
+}
 
-    //SimpleCpuDataSnapshot is protected so cast
-    _latestSnapshot = &_snapshots.appendSnapshot(snap);
+SimpleCpuDataSampler::SimpleCpuDataSampler(QObject* parent)
+: SimpleCpuDataEntryBase(&_history, 0, parent)
+, _history(_maxSamples)
+, _coresModel(&_history, this)
+{
+    _history.setRows(1);
 }
 
 QString SimpleCpuDataSampler::name() const
@@ -153,67 +461,342 @@ QString SimpleCpuDataSampler::name() const
 
 qreal SimpleCpuDataSampler::load1() const
 {
-    return _load1;
+    return announcedOrZero(_load1);
 }
 
 qreal SimpleCpuDataSampler::load5() const
 {
-    return _load5;
+    return announcedOrZero(_load5);
 }
 
 qreal SimpleCpuDataSampler::load15() const
 {
-    return _load15;
+    return announcedOrZero(_load15);
+}
+
+void SimpleCpuDataSampler::set_maxSamples(const int maxSamples)
+{
+    if (_maxSamples == maxSamples) return;
+    _maxSamples = maxSamples;
+
+    relayoutHistory([this]
+    {
+        _history.setCapacity(_maxSamples);
+    });
+
+    emit staticChanged();
 }
 
-void SimpleCpuDataSampler::sample(const Data_Cpu& data)
+void SimpleCpuDataSampler::relayoutHistory(const std::function<void()>& change)
 {
-    _load1  = data.load1;
-    _load5  = data.load5;
-    _load15 = data.load15;
+    _snapshots.beginRelayout();
+    _coresModel.history()->beginRelayout();
+    for (const auto& core : _cores)
+        core->_snapshots.beginRelayout();
+
+    change();
+
+    for (const auto& core : _cores)
+        core->_snapshots.endRelayout();
+    _coresModel.history()->endRelayout();
+    _snapshots.endRelayout();
+
+    emit historyReset();
+}
+
+void SimpleCpuDataSampler::sample(const Snapshot_Cpu& snapshot)
+{
+    const Data_Cpu& data = *snapshot;
+
+    if (leavesDeadBand(_load1, data.load1, _loadThresholds[0]))
+        emit load1Changed();
+    if (leavesDeadBand(_load5, data.load5, _loadThresholds[1]))
+        emit load5Changed();
+    if (leavesDeadBand(_load15, data.load15, _loadThresholds[2]))
+        emit load15Changed();
 
     if (data.cpus.empty()) return;
 
-    // create mutable copy
-    Data_Cpu::CpuData cpuData = data.cpus[0];
+    // The snapshot is shared with every other consumer, aggregate next to it
+    const Data_Cpu::CpuData& cpuData = data.cpus[0];
+    const qsizetype coreCount = cpuData.cores.size();
 
-    float accTemp = 0;
-    float accFreq = 0;
+    bool grown = _history.rows() < coreCount + 1;
+    if (grown)
+    {
+        _history.setRows(coreCount + 1);
+        restoreHistory();
+    }
+
+    // Fill one input row per entry, the store derives utilization for all of
+    // them in a single pass. Frequencies are reported in kHz, stored in MHz.
+    auto& input = _history.input();
+
+    Data_Cpu::Stats aggregate = cpuData.stats;
+    qreal accTemp = 0;
+    qreal accFreq = 0;
 
-    qsizetype i = 0;
-    for (const auto& coreData : cpuData.cores)
+    for (qsizetype i = 0; i < coreCount; ++i)
     {
-        if (_cores.size() <= i)
-        {
-            // Create new entry
-            auto thiz = static_cast<SimpleCpuDataEntryBase*>(this);
-            const auto entry = _cores.emplace_back(new SimpleCpuDataEntryBase(thiz));
-            entry->importData(coreData);
+        const auto& coreData  = cpuData.cores[i];
+        const qsizetype row   = i + 1;
+
+        input.total[row]   = coreData.stats.total();
+        input.idle[row]    = coreData.stats.idle;
+        input.freq[row]    = coreData.freqNow / 1000;
+        input.freqMin[row] = coreData.freqMin / 1000;
+        input.freqMax[row] = coreData.freqMax / 1000;
+        input.temp[row]    = coreData.temp;
+        input.draw[row]    = 0.0;
+
+        accTemp   += coreData.temp;
+        accFreq   += input.freq[row];
+        aggregate += coreData.stats;
+    }
 
-            emit staticChanged();
-        }
+    // Cores that went offline keep their history but stop sampling
+    for (qsizetype row = coreCount + 1; row < _history.rows(); ++row)
+    {
+        input.total[row] = 0;
+        input.idle[row]  = 0;
+        input.freq[row]  = input.temp[row] = input.draw[row] = 0.0;
+        input.freqMin[row] = input.freqMax[row] = 0.0;
+    }
 
-        else
-            _cores.at(i)->importData(coreData);
+    input.total[0]   = aggregate.total();
+    input.idle[0]    = aggregate.idle;
+    input.freq[0]    = coreCount > 0 ? accFreq / coreCount : 0.0;
+    input.freqMin[0] = coreCount > 0 ? input.freqMin[1] : 0.0;
+    input.freqMax[0] = coreCount > 0 ? input.freqMax[1] : 0.0;
+    input.temp[0]    = coreCount > 0 ? accTemp / coreCount : 0.0;
+    input.draw[0]    = cpuData.draw;
+
+    const qint64 timestamp = QDateTime::currentMSecsSinceEpoch();
+    _history.append(timestamp);
+
+    if (_archive && _archive->append(timestamp, _history.rows(), _history.lastSample()))
+        maintainArchive();
+
+    // Only once someone asked for cores, before that no core has an object
+    if (_coresRequested)
+        createCores();
+
+    // One model notification per tick for every history
+    for (const auto& core : _cores)
+        core->_snapshots.flush();
+    _snapshots.flush();
+
+    if (_name != cpuData.name)
+    {
+        _name = cpuData.name;
+        grown = true;
+    }
+
+    if (grown)
+        emit staticChanged();
+
+    emit historyAppended();
 
-        accTemp += _cores.at(i)->temperature();
-        accFreq += _cores.at(i)->frequency();
+    _coresModel.update(_thresholds);
 
-        cpuData.stats += coreData.stats;
+    for (const auto& core : _cores)
+        core->publish(_thresholds);
+    publish(_thresholds);
+}
+
+static constexpr std::pair<const char*, MetricGroup> metricNames[] = {
+    { "loadavg",    MetricGroup::LoadAvg    },
+    { "stats",      MetricGroup::CoreStats  },
+    { "frequency",  MetricGroup::Frequency  },
+    { "cpuinfo",    MetricGroup::CpuInfo    },
+    { "interrupts", MetricGroup::Interrupts },
+    { "softirqs",   MetricGroup::SoftIrqs   },
+    { "temperature", MetricGroup::Temperature },
+    { "power",       MetricGroup::Power       },
+};
+
+QStringList SimpleCpuDataSampler::metrics() const
+{
+    QStringList metrics;
+    for (const auto& [name, group] : metricNames)
+        if (_groups.testFlag(group))
+            metrics.append(name);
 
-        cpuData.freqMin = _cores.at(i)->frequencyMin();
-        cpuData.freqMax = _cores.at(i)->frequencyMax();
+    return metrics;
+}
 
-        ++i;
+void SimpleCpuDataSampler::metrics(const QStringList& metrics)
+{
+    MetricGroups groups = MetricGroup::None;
+    for (const auto& metric : metrics)
+    {
+        const auto it = std::ranges::find_if(metricNames, [&metric](const auto& entry)
+        {
+            return metric == QLatin1StringView(entry.first);
+        });
+
+        if (it == std::end(metricNames))
+            qWarning() << "Unknown cpu metric" << metric;
+        else
+            groups |= it->second;
     }
 
-    cpuData.freqNow = (accFreq / i);
-    cpuData.temp    = accTemp / i ;
+    if (_groups == groups) return;
+    _groups = groups;
+
+    if (_manager)
+        _manager->subscribe(this, _groups);
+
+    emit metricsChanged();
+}
+
+namespace
+{
+// Persisted history reaches as far back as the coarsest tier and is
+// downsampled to one sample per minute once it is a day old
+constexpr qint64 historyRetention       = 7 * 24 * 3600 * 1000LL;
+constexpr qint64 historyCompactAfter    = 24 * 3600 * 1000LL;
+constexpr qint64 historyCompactInterval = 60 * 1000;
+}
+
+QString SimpleCpuDataSampler::historyPath() const
+{
+    return _historyPath;
+}
+
+void SimpleCpuDataSampler::historyPath(const QString& path)
+{
+    if (_historyPath == path) return;
+    _historyPath = path;
+
+    openArchive();
+
+    emit historyPathChanged();
+}
+
+void SimpleCpuDataSampler::openArchive()
+{
+    const quint64 generation = ++_archiveGeneration;
+
+    _archive.reset();
+    _restoredHistory.reset();
 
-    importData(cpuData, cpuData.draw);
-    _name = cpuData.name;
+    if (_historyPath.isEmpty()) return;
 
-    emit dynamicChanged();
+    _archive = std::make_unique<HistoryArchive>(_historyPath, CpuHistoryStore::MetricCount);
+
+    // Earlier sessions are compacted and decoded on the thread pool, nothing
+    // is read before the first frame
+    using Restored_t = std::shared_ptr<const CpuHistoryStore>;
+    auto promise = std::make_shared<QPromise<Restored_t>>();
+    auto future  = promise->future();
+
+    // Listed before the first sample, the segments this session writes are
+    // neither compacted nor replayed into its own history
+    const QStringList segments = HistoryArchive::segments(_historyPath);
+    const qsizetype capacity   = _history.capacity();
+    const qint64 now           = QDateTime::currentMSecsSinceEpoch();
+
+    QThreadPool::globalInstance()->start([promise, segments, capacity, now]
+    {
+        promise->start();
+
+        HistoryArchive::maintain(segments, now - historyRetention, now - historyCompactAfter, historyCompactInterval);
+
+        auto history = std::make_shared<CpuHistoryStore>(capacity);
+
+        HistoryArchive::replay(
+            segments, now - historyRetention, now,
+            [&history](const qint64 timestamp, const qsizetype rows, const std::span<const qreal> values)
+            {
+                if (rows != history->rows())
+                    history->setRows(rows);
+                history->appendRecord(timestamp, values);
+            });
+
+        promise->addResult(std::move(history));
+        promise->finish();
+    });
+
+    future.then(this, [this, generation](const Restored_t& history)
+    {
+        if (generation != _archiveGeneration) return;
+
+        _restoredHistory = history;
+        restoreHistory();
+    });
+}
+
+void SimpleCpuDataSampler::maintainArchive() const
+{
+    QThreadPool::globalInstance()->start([directory = _historyPath, active = _archive->activeSegment()]
+    {
+        const qint64 now = QDateTime::currentMSecsSinceEpoch();
+
+        HistoryArchive::maintain(
+            HistoryArchive::segments(directory, active),
+            now - historyRetention, now - historyCompactAfter, historyCompactInterval);
+    });
+}
+
+void SimpleCpuDataSampler::restoreHistory()
+{
+    // Wait for the first sample to create the cores, their rows would be
+    // dropped otherwise
+    if (!_restoredHistory || (_history.rows() <= 1 && _restoredHistory->rows() > _history.rows())) return;
+
+    relayoutHistory([this]
+    {
+        _history.merge(*_restoredHistory);
+    });
+
+    _restoredHistory.reset();
+}
+
+QVariantMap SimpleCpuDataSampler::thresholds() const
+{
+    QVariantMap thresholds;
+
+    for (const auto& [name, metric] : metricProperties)
+        if (_thresholds[metric] > 0)
+            thresholds.insert(name, _thresholds[metric]);
+
+    for (qsizetype i = 0; i < std::ssize(loadProperties); ++i)
+        if (_loadThresholds[i] > 0)
+            thresholds.insert(loadProperties[i], _loadThresholds[i]);
+
+    return thresholds;
+}
+
+void SimpleCpuDataSampler::thresholds(const QVariantMap& thresholds)
+{
+    CpuThresholds_t metricThresholds {};
+    std::array<qreal, 3> loadThresholds {};
+
+    for (auto it = thresholds.begin(); it != thresholds.end(); ++it)
+    {
+        const auto matches = [&it](const char* name) { return it.key() == QLatin1StringView(name); };
+        const qreal threshold = qMax(it.value().toReal(), 0.0);
+
+        const auto metric = std::ranges::find_if(metricProperties, [&matches](const auto& entry)
+        {
+            return matches(entry.first);
+        });
+        const auto load = std::ranges::find_if(loadProperties, matches);
+
+        if (metric != std::end(metricProperties))
+            metricThresholds[metric->second] = threshold;
+        else if (load != std::end(loadProperties))
+            loadThresholds[load - std::begin(loadProperties)] = threshold;
+        else
+            qWarning() << "Unknown threshold property" << it.key();
+    }
+
+    if (_thresholds == metricThresholds && _loadThresholds == loadThresholds) return;
+    _thresholds     = metricThresholds;
+    _loadThresholds = loadThresholds;
+
+    emit thresholdsChanged();
 }
 
 void SimpleCpuDataSampler::classBegin()
@@ -230,12 +813,51 @@ void SimpleCpuDataSampler::componentComplete()
     // works for singletons registered with qmlRegisterSingletonType or qmlRegisterSingletonInstance
     auto* singleton = engine->singletonInstance<hw_monitor::HardwareManager*>("HardwareManager", "HardwareManager");
     if (singleton)
+    {
+        _manager = singleton;
+
         connect(
             singleton, &hw_monitor::HardwareManager::cpuDataChanged,
             this, &SimpleCpuDataSampler::sample);
+
+        singleton->subscribe(this, _groups);
+    }
 }
 
-const QVector<SimpleCpuDataCoreEntry*>& SimpleCpuDataSampler::cores() const
+const QVector<SimpleCpuDataCoreEntry*>& SimpleCpuDataSampler::cores()
 {
+    if (!_coresRequested)
+    {
+        _coresRequested = true;
+        createCores();
+    }
+
     return _cores;
+}
+
+void SimpleCpuDataSampler::createCores()
+{
+    auto thiz = static_cast<SimpleCpuDataEntryBase*>(this);
+
+    // Store row 0 is the aggregate
+    while (_cores.size() < _history.rows() - 1)
+    {
+        auto* core = new SimpleCpuDataEntryBase(&_history, _cores.size() + 1, thiz);
+
+        // Starts out with the history and values the store already holds
+        core->_snapshots.flush();
+        core->publish(_thresholds);
+
+        _cores.emplace_back(core);
+    }
+}
+
+SimpleCpuDataCoresModel* SimpleCpuDataSampler::coresModel()
+{
+    return &_coresModel;
+}
+
+const CpuHistoryStore& SimpleCpuDataSampler::historyStore() const
+{
+    return _history;
 }
\ No newline at end of file
@@ -3,9 +3,28 @@
 #include <qabstractitemmodel.h>
 #include <qqmlintegration.h>
 #include <qqmlparserstatus.h>
+#include <qpointer.h>
+#include <qstringlist.h>
 #include <qtypes.h>
 
 #include "../collection/cpu_data.h"
+#include "../enums.h"
+#include "cpu_history_store.h"
+#include "history_archive.h"
+
+#include <array>
+#include <functional>
+#include <limits>
+#include <memory>
+
+namespace hw_monitor { class HardwareManager; }
+
+// Dead-band per CpuHistoryStore::Metric
+using CpuThresholds_t = std::array<qreal, CpuHistoryStore::MetricCount>;
+
+// Metric of a property name, "frequency", "temperature", "utilization" or
+// "powerDraw". Returns false for anything else.
+bool cpuMetricFromName(const QString& name, CpuHistoryStore::Metric& metric);
 
 struct SimpleCpuDataSnapshot
 {
@@ -15,7 +34,12 @@ struct SimpleCpuDataSnapshot
     qreal draw = 0.0;
 };
 
-class SimpleCpuDataSnapshotModel : public QAbstractListModel
+// History of consecutive rows of a CpuHistoryStore, one sample per row and
+// one store row per column. Holds no samples itself, it only tracks how much
+// of the store it has announced. Once the store is full every row shifts by
+// one per sample, which is reported as a single dataChanged over all rows on
+// flush().
+class SimpleCpuDataSnapshotModel : public QAbstractTableModel
 {
     Q_OBJECT
 
@@ -26,25 +50,91 @@ public:
         Frequency,
         Utilization,
         PowerDraw,
+        Time,
     };
 
+    SimpleCpuDataSnapshotModel(
+        const CpuHistoryStore* store,
+        qsizetype row,
+        qsizetype columns = 1,
+        QObject* parent = nullptr);
+
     [[nodiscard]] QHash<int, QByteArray> roleNames() const override;
 
     [[nodiscard]] int rowCount(const QModelIndex& parent) const override;
+    [[nodiscard]] int columnCount(const QModelIndex& parent) const override;
     [[nodiscard]] QVariant data(const QModelIndex& index, int role) const override;
 
     [[nodiscard]] qsizetype size() const;
     [[nodiscard]] qsizetype maxSize() const;
 
-    void maxSize(qsizetype size);
+    [[nodiscard]] qsizetype columns() const;
+    void columns(qsizetype columns);
+
+    // Sample of column 0
+    [[nodiscard]] SimpleCpuDataSnapshot snapshotAt(qsizetype row) const;
+
+    // Emits the changes of all appends since the last flush, once per tick
+    void flush();
+
+    // Bracket a capacity change of the store, announced as a model reset
+    void beginRelayout();
+    void endRelayout();
+
+private:
+    const CpuHistoryStore* _store;
+    const qsizetype _row;   // store row of column 0
+    qsizetype _columns;
+
+    qsizetype _visible = 0;  // rows announced to views
+    quint64 _seenSequence = 0;
+};
+
+// Latest values of every core in one table, a row per core and a column per
+// CpuHistoryStore::Metric. The metrics are also available as roles on any
+// column for list views. All changes of a tick are announced as a single
+// dataChanged, values within their dead-band are not updated. history is
+// the matching sample x core table.
+class SimpleCpuDataCoresModel : public QAbstractTableModel
+{
+    Q_OBJECT
+    Q_PROPERTY(SimpleCpuDataSnapshotModel* history READ history CONSTANT)
+    QML_ANONYMOUS
+
+public:
+    enum class Roles
+    {
+        Temperature = Qt::UserRole + 1,
+        Frequency,
+        Utilization,
+        PowerDraw,
+        FrequencyMin,
+        FrequencyMax,
+    };
+
+    explicit SimpleCpuDataCoresModel(const CpuHistoryStore* store, QObject* parent = nullptr);
+
+    [[nodiscard]] QHash<int, QByteArray> roleNames() const override;
+
+    [[nodiscard]] int rowCount(const QModelIndex& parent) const override;
+    [[nodiscard]] int columnCount(const QModelIndex& parent) const override;
+    [[nodiscard]] QVariant data(const QModelIndex& index, int role) const override;
 
-    [[nodiscard]] const SimpleCpuDataSnapshot& snapshotAt(qsizetype row) const;
+    [[nodiscard]] SimpleCpuDataSnapshotModel* history();
 
-    const SimpleCpuDataSnapshot& appendSnapshot(const SimpleCpuDataSnapshot& s);
+    // Follows the store after an append: inserts rows for new cores and
+    // announces the values that left their dead-band
+    void update(const CpuThresholds_t& thresholds);
 
 private:
-    qsizetype _maxSize = 50;
-    QVector<SimpleCpuDataSnapshot> _snapshots;
+    const CpuHistoryStore* _store;
+
+    qsizetype _cores = 0;
+
+    // Announced values, [core * MetricCount + metric], NaN until the first
+    std::vector<qreal> _announced;
+
+    SimpleCpuDataSnapshotModel _history;
 };
 
 class SimpleCpuDataEntryBase : public QObject
@@ -52,40 +142,66 @@ class SimpleCpuDataEntryBase : public QObject
     Q_OBJECT
     Q_PROPERTY(qreal frequencyMin READ frequencyMin NOTIFY staticChanged);
     Q_PROPERTY(qreal frequencyMax READ frequencyMax NOTIFY staticChanged);
-    Q_PROPERTY(qreal frequency    READ frequency    NOTIFY dynamicChanged);
-    Q_PROPERTY(qreal temperature  READ temperature  NOTIFY dynamicChanged);
-    Q_PROPERTY(qreal utilization  READ utilization  NOTIFY dynamicChanged);
-    Q_PROPERTY(qreal powerDraw    READ powerDraw    NOTIFY dynamicChanged);
+    Q_PROPERTY(qreal frequency    READ frequency    NOTIFY frequencyChanged);
+    Q_PROPERTY(qreal temperature  READ temperature  NOTIFY temperatureChanged);
+    Q_PROPERTY(qreal utilization  READ utilization  NOTIFY utilizationChanged);
+    Q_PROPERTY(qreal powerDraw    READ powerDraw    NOTIFY powerDrawChanged);
 
     friend class SimpleCpuDataSampler;
 
 public:
-    explicit SimpleCpuDataEntryBase(QObject* parent = nullptr);
+    SimpleCpuDataEntryBase(CpuHistoryStore* store, qsizetype row, QObject* parent = nullptr);
 
     [[nodiscard]] qreal frequencyMin() const;
     [[nodiscard]] qreal frequencyMax() const;
+
+    // Values as last announced, they only follow the history once they
+    // moved beyond the samplers threshold
     [[nodiscard]] qreal frequency()    const;
     [[nodiscard]] qreal temperature()  const;
     [[nodiscard]] qreal utilization()  const;
     [[nodiscard]] qreal powerDraw()    const;
 
+    // The last seconds of metric ("frequency", "temperature", "utilization"
+    // or "powerDraw") at roughly points points, as { time, min, max, mean }
+    // maps. Served from raw samples or a downsampled tier, never scans more
+    // than it returns.
+    Q_INVOKABLE QVariantList history(const QString& metric, int seconds, int points) const;
+
+    // Raw samples of metric in one call instead of one data() per row and
+    // role. since is a sample number as returned by seriesEnd(), so a chart
+    // can fetch only the tail it has not seen yet; negative returns every
+    // held sample. Samples that were already dropped are skipped.
+    Q_INVOKABLE QList<qreal> series(const QString& metric, qint64 since = -1) const;
+    // Same as series() as float32, an ArrayBuffer for a Float32Array in QML
+    Q_INVOKABLE QByteArray seriesBuffer(const QString& metric, qint64 since = -1) const;
+    // Timestamps in ms since epoch matching series()
+    Q_INVOKABLE QList<qint64> seriesTimes(qint64 since = -1) const;
+    // Number of the next sample, pass it as since to fetch what follows
+    Q_INVOKABLE qint64 seriesEnd() const;
+
 signals:
-    void dynamicChanged();
+    void frequencyChanged();
+    void temperatureChanged();
+    void utilizationChanged();
+    void powerDrawChanged();
     void staticChanged();
 
 protected:
     using Model_t = SimpleCpuDataSnapshotModel;
 
-    const SimpleCpuDataSnapshot* _latestSnapshot = nullptr;
-
-    qreal _freqMin = 0.0;
-    qreal _freqMax = 0.0;
+    // A view on one row of the samplers store
+    CpuHistoryStore* _store;
+    qsizetype _row;
 
-    quint64 _total = 0;
-    quint64 _idle  = 0;
     Model_t _snapshots;
 
-    void importData(const Data_Cpu::Entry& entry, qreal draw = 0.0);
+    // Announced values by CpuHistoryStore::Metric, NaN until the first
+    std::array<qreal, CpuHistoryStore::MetricCount> _published;
+
+    // Announces the metrics whose latest value moved more than their
+    // threshold away from the announced one
+    void publish(const CpuThresholds_t& thresholds);
 };
 
 using SimpleCpuDataCoreEntry = SimpleCpuDataEntryBase;
@@ -96,51 +212,119 @@ class SimpleCpuDataSampler
 {
     Q_OBJECT
     Q_PROPERTY(QString name READ name   NOTIFY staticChanged)
-    Q_PROPERTY(qreal load1  READ load1  NOTIFY dynamicChanged)
-    Q_PROPERTY(qreal load5  READ load5  NOTIFY dynamicChanged)
-    Q_PROPERTY(qreal load15 READ load15 NOTIFY dynamicChanged)
-    Q_PROPERTY(int maxSamples READ maxSamples NOTIFY staticChanged)
+    Q_PROPERTY(qreal load1  READ load1  NOTIFY load1Changed)
+    Q_PROPERTY(qreal load5  READ load5  NOTIFY load5Changed)
+    Q_PROPERTY(qreal load15 READ load15 NOTIFY load15Changed)
+    Q_PROPERTY(int maxSamples READ maxSamples WRITE set_maxSamples NOTIFY staticChanged)
+    Q_PROPERTY(QStringList metrics READ metrics WRITE metrics NOTIFY metricsChanged)
+    Q_PROPERTY(QString historyPath READ historyPath WRITE historyPath NOTIFY historyPathChanged)
+    Q_PROPERTY(QVariantMap thresholds READ thresholds WRITE thresholds NOTIFY thresholdsChanged)
     Q_PROPERTY(QVector<SimpleCpuDataCoreEntry*> cores READ cores NOTIFY staticChanged)
+    Q_PROPERTY(SimpleCpuDataCoresModel* coresModel READ coresModel CONSTANT)
     Q_INTERFACES(QQmlParserStatus)
     QML_NAMED_ELEMENT(CpuDataSampler)
 
 public:
+    explicit SimpleCpuDataSampler(QObject* parent = nullptr);
+
     [[nodiscard]] QString name()  const;
     [[nodiscard]] qreal load1()  const;
     [[nodiscard]] qreal load5()  const;
     [[nodiscard]] qreal load15() const;
-    [[nodiscard]] const QVector<SimpleCpuDataCoreEntry*>& cores() const;
+    // One object per core, created on first use. Until then a tick costs
+    // nothing per core apart from coresModel.
+    [[nodiscard]] const QVector<SimpleCpuDataCoreEntry*>& cores();
+
+    // All cores in one model, cheaper than cores for views over many cores
+    [[nodiscard]] SimpleCpuDataCoresModel* coresModel();
+
+    // For C++ views reading the samples directly, see historyAppended and
+    // historyReset
+    [[nodiscard]] const CpuHistoryStore& historyStore() const;
+
+    // Metric groups this sampler subscribes to: "loadavg", "stats",
+    // "frequency", "cpuinfo", "interrupts", "softirqs", "temperature" and
+    // "power". Everything the sampler displays by default, a widget showing
+    // only load1 needs "loadavg".
+    [[nodiscard]] QStringList metrics() const;
+    void metrics(const QStringList& metrics);
+
+    // Directory persisting the history across restarts, empty keeps it in
+    // memory only. Earlier sessions are loaded in the background and merged
+    // into the history once ready.
+    [[nodiscard]] QString historyPath() const;
+    void historyPath(const QString& path);
+
+    // Dead-band per property, e.g. { "utilization": 0.01, "temperature": 0.5 }.
+    // A property only notifies once its value moved more than its threshold
+    // since the last notification. Applies to the cores as well, properties
+    // left out notify on every change.
+    [[nodiscard]] QVariantMap thresholds() const;
+    void thresholds(const QVariantMap& thresholds);
 
     [[nodiscard]] int maxSamples() const
     {
         return _maxSamples;
     }
 
-    void set_maxSamples(const int maxSamples)
-    {
-        if (_maxSamples == maxSamples) return;
-        _maxSamples = maxSamples;
-
-        _snapshots.maxSize(_maxSamples);
-        for (auto& core : _cores)
-            core->_snapshots.maxSize(_maxSamples);
-
-        emit staticChanged();
-    }
+    void set_maxSamples(int maxSamples);
 
-    void sample(const Data_Cpu& data);
+    void sample(const Snapshot_Cpu& snapshot);
 
     void classBegin() override;
     void componentComplete() override;
 
+signals:
+    void metricsChanged();
+    void historyPathChanged();
+    void thresholdsChanged();
+    void load1Changed();
+    void load5Changed();
+    void load15Changed();
+
+    // A sample was appended to historyStore()
+    void historyAppended();
+    // historyStore() was relaid or merged, earlier samples may have moved
+    void historyReset();
+
 private:
+    MetricGroups _groups = MetricGroup::LoadAvg | MetricGroup::CoreStats | MetricGroup::Frequency | MetricGroup::CpuInfo
+                         | MetricGroup::Temperature | MetricGroup::Power;
+    QPointer<hw_monitor::HardwareManager> _manager;
+
     int _maxSamples = 50;
 
+    // Row 0 is this sampler, row i + 1 is core i
+    CpuHistoryStore _history;
+    SimpleCpuDataCoresModel _coresModel;
+
+    QString _historyPath;
+    std::unique_ptr<HistoryArchive> _archive;
+    quint64 _archiveGeneration = 0;
+
+    // Loaded from the archive, merged once the cores exist
+    std::shared_ptr<const CpuHistoryStore> _restoredHistory;
+
+    void openArchive();
+    void maintainArchive() const;
+    void restoreHistory();
+
+    // Runs change on _history, announced to every model as a reset
+    void relayoutHistory(const std::function<void()>& change);
+
     QString _name = "N/A";
 
-    qreal _load1  = 0.0;
-    qreal _load5  = 0.0;
-    qreal _load15 = 0.0;
+    // Announced load averages, NaN until the first
+    qreal _load1  = std::numeric_limits<qreal>::quiet_NaN();
+    qreal _load5  = std::numeric_limits<qreal>::quiet_NaN();
+    qreal _load15 = std::numeric_limits<qreal>::quiet_NaN();
+
+    CpuThresholds_t _thresholds {};
+    std::array<qreal, 3> _loadThresholds {}; // load1, load5, load15
 
+    bool _coresRequested = false;
     QVector<SimpleCpuDataCoreEntry*> _cores;
+
+    // Adds an entry for every store row that has none yet
+    void createCores();
 };
\ No newline at end of file
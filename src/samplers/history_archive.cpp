@@ -0,0 +1,510 @@
+#include "history_archive.h"
+
+#include <qdebug.h>
+#include <qdir.h>
+#include <qfile.h>
+#include <qfileinfo.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+
+namespace
+{
+constexpr char      segmentMagic[8]  = { 'H', 'W', 'H', 'I', 'S', 'T', '0', '1' };
+constexpr quint32   segmentVersion   = 1;
+constexpr qsizetype segmentSize      = 4 << 20;
+constexpr qsizetype keyframeInterval = 64;
+
+// Values are stored as fixed point with three decimals
+constexpr qreal fixedPointScale = 1000.0;
+
+struct SegmentHeader
+{
+    char    magic[8];
+    quint32 version;
+    quint32 metrics;
+    quint64 used;      // bytes in use, including this header
+    qint64  firstTime;
+    qint64  lastTime;
+    quint32 compacted;
+    quint32 reserved;
+};
+
+struct IndexEntry
+{
+    qint64  time;
+    quint64 offset; // of a keyframe record
+};
+
+enum RecordType : uchar
+{
+    Delta,
+    Keyframe,
+};
+
+void putVarint(uchar*& p, quint64 value)
+{
+    while (value >= 0x80)
+    {
+        *p++ = static_cast<uchar>(value) | 0x80;
+        value >>= 7;
+    }
+    *p++ = static_cast<uchar>(value);
+}
+
+bool getVarint(const uchar*& p, const uchar* end, quint64& value)
+{
+    value = 0;
+    for (int shift = 0; p < end && shift < 64; shift += 7)
+    {
+        const uchar byte = *p++;
+        value |= static_cast<quint64>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+quint64 zigzag(const qint64 value)
+{
+    return (static_cast<quint64>(value) << 1) ^ static_cast<quint64>(value >> 63);
+}
+
+qint64 unzigzag(const quint64 value)
+{
+    return static_cast<qint64>(value >> 1) ^ -static_cast<qint64>(value & 1);
+}
+
+qint64 toFixedPoint(const qreal value)
+{
+    return std::isfinite(value) ? std::llround(value * fixedPointScale) : 0;
+}
+
+QString indexPath(const QString& segmentPath)
+{
+    return segmentPath.endsWith(".seg") ? segmentPath.chopped(4) + ".idx" : segmentPath + ".idx";
+}
+
+// Held by maintain() while it replaces segments, and by replay() so it never
+// sees a segment and its index from different sides of that
+std::mutex archiveMutex;
+}
+
+class HistoryArchive::Segment
+{
+public:
+    ~Segment()
+    {
+        if (_map) munmap(_map, _size);
+        if (_fd >= 0) close(_fd);
+        if (_indexFd >= 0) close(_indexFd);
+    }
+
+    static std::unique_ptr<Segment> create(const QString& path, const qsizetype metrics, const qsizetype size)
+    {
+        auto segment = std::unique_ptr<Segment>(new Segment(path));
+
+        const QByteArray file = path.toLocal8Bit();
+        segment->_fd = ::open(file.constData(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (segment->_fd < 0 || ftruncate(segment->_fd, size) != 0)
+        {
+            qWarning() << "Failed to create history segment" << path << strerror(errno);
+            return nullptr;
+        }
+
+        const QByteArray index = indexPath(path).toLocal8Bit();
+        segment->_indexFd = ::open(index.constData(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+        if (segment->_indexFd < 0 || !segment->map(size, true))
+        {
+            qWarning() << "Failed to create history index" << path << strerror(errno);
+            return nullptr;
+        }
+
+        auto* header = segment->header();
+        *header = {};
+        memcpy(header->magic, segmentMagic, sizeof(segmentMagic));
+        header->version = segmentVersion;
+        header->metrics = static_cast<quint32>(metrics);
+        header->used    = sizeof(SegmentHeader);
+
+        segment->_metrics = metrics;
+        return segment;
+    }
+
+    static std::unique_ptr<Segment> open(const QString& path)
+    {
+        auto segment = std::unique_ptr<Segment>(new Segment(path));
+
+        const QByteArray file = path.toLocal8Bit();
+        segment->_fd = ::open(file.constData(), O_RDONLY | O_CLOEXEC);
+
+        struct stat info {};
+        if (segment->_fd < 0 && errno == ENOENT) return nullptr; // deleted by maintain()
+
+        if (segment->_fd < 0 || fstat(segment->_fd, &info) != 0 || info.st_size < qsizetype(sizeof(SegmentHeader))
+            || !segment->map(info.st_size, false))
+        {
+            qWarning() << "Failed to open history segment" << path;
+            return nullptr;
+        }
+
+        const auto* header = segment->header();
+        if (memcmp(header->magic, segmentMagic, sizeof(segmentMagic)) != 0 || header->version != segmentVersion
+            || header->used > static_cast<quint64>(info.st_size))
+        {
+            qWarning() << "Invalid history segment" << path;
+            return nullptr;
+        }
+
+        segment->_metrics = header->metrics;
+        return segment;
+    }
+
+    [[nodiscard]] const QString& path() const { return _path; }
+
+    [[nodiscard]] SegmentHeader* header() const { return reinterpret_cast<SegmentHeader*>(_map); }
+
+    // Returns false when the record does not fit
+    bool append(const qint64 timestamp, const qsizetype rows, const std::span<const qreal> values)
+    {
+        auto* header = this->header();
+
+        const qsizetype maxRecord = 1 + 2 * 10 + rows * _metrics * 10;
+        if (static_cast<qsizetype>(header->used) + maxRecord > _size) return false;
+
+        const bool keyframe = rows != _rows || _sinceKeyframe >= keyframeInterval;
+        const quint64 offset = header->used;
+
+        uchar* p = _map + offset;
+        *p++ = keyframe ? Keyframe : Delta;
+        putVarint(p, keyframe ? zigzag(timestamp) : zigzag(timestamp - _prevTime));
+        putVarint(p, rows);
+
+        _prev.resize(rows * _metrics, 0);
+        for (qsizetype i = 0; i < rows * _metrics; ++i)
+        {
+            const qint64 value = toFixedPoint(values[i]);
+            putVarint(p, zigzag(keyframe ? value : value - _prev[i]));
+            _prev[i] = value;
+        }
+
+        if (keyframe)
+        {
+            const IndexEntry entry { timestamp, offset };
+            if (write(_indexFd, &entry, sizeof(entry)) != sizeof(entry))
+                qWarning() << "Failed to write history index" << _path << strerror(errno);
+
+            _sinceKeyframe = 0;
+        }
+
+        _rows     = rows;
+        _prevTime = timestamp;
+        ++_sinceKeyframe;
+
+        if (header->used == sizeof(SegmentHeader))
+            header->firstTime = timestamp;
+        header->lastTime = timestamp;
+        header->used     = p - _map;
+
+        return true;
+    }
+
+    // Drops the unused preallocated tail, the segment is read only afterwards
+    void seal()
+    {
+        const auto used = static_cast<qsizetype>(header()->used);
+
+        munmap(_map, _size);
+        _map = nullptr;
+
+        if (ftruncate(_fd, used) != 0)
+            qWarning() << "Failed to truncate history segment" << _path << strerror(errno);
+    }
+
+    void decode(const qint64 since, const Sink_t& sink) const
+    {
+        const auto* header = this->header();
+        const uchar* p     = _map + sizeof(SegmentHeader);
+        const uchar* end   = _map + header->used;
+
+        // Start at the last keyframe at or before since
+        const auto index = readIndex();
+        const auto it = std::ranges::upper_bound(index, since, {}, &IndexEntry::time);
+        if (it != index.begin() && std::prev(it)->offset < header->used)
+        {
+            // An index left behind by an interrupted compaction points into
+            // other records, it is only trusted where it finds its keyframe
+            const uchar* keyframe = _map + std::prev(it)->offset;
+            const uchar* q = keyframe;
+            quint64 raw = 0;
+
+            if (*q++ == Keyframe && getVarint(q, end, raw) && unzigzag(raw) == std::prev(it)->time)
+                p = keyframe;
+        }
+
+        qint64 time = 0;
+        std::vector<qint64> values;
+        std::vector<qreal> scaled;
+
+        while (p < end)
+        {
+            const uchar type = *p++;
+            quint64 raw  = 0;
+            quint64 rows = 0;
+
+            if (type > Keyframe || !getVarint(p, end, raw) || !getVarint(p, end, rows)
+                || rows * _metrics > static_cast<quint64>(end - p))
+            {
+                qWarning() << "Corrupt history segment" << _path;
+                return;
+            }
+
+            const bool keyframe = type == Keyframe;
+            time = keyframe ? unzigzag(raw) : time + unzigzag(raw);
+
+            const qsizetype count = static_cast<qsizetype>(rows) * _metrics;
+            values.resize(count, 0);
+            scaled.resize(count);
+
+            for (qsizetype i = 0; i < count; ++i)
+            {
+                if (!getVarint(p, end, raw))
+                {
+                    qWarning() << "Corrupt history segment" << _path;
+                    return;
+                }
+
+                values[i] = keyframe ? unzigzag(raw) : values[i] + unzigzag(raw);
+                scaled[i] = static_cast<qreal>(values[i]) / fixedPointScale;
+            }
+
+            if (time >= since)
+                sink(time, static_cast<qsizetype>(rows), scaled);
+        }
+    }
+
+private:
+    explicit Segment(QString path)
+    : _path(std::move(path)) {}
+
+    QString _path;
+
+    int _fd      = -1;
+    int _indexFd = -1;
+
+    uchar* _map     = nullptr;
+    qsizetype _size = 0;
+
+    qsizetype _metrics = 0;
+
+    // Encoder state
+    qint64 _prevTime = 0;
+    qsizetype _rows  = -1;
+    qsizetype _sinceKeyframe = 0;
+    std::vector<qint64> _prev;
+
+    bool map(const qsizetype size, const bool writable)
+    {
+        void* map = mmap(nullptr, size, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, _fd, 0);
+        if (map == MAP_FAILED) return false;
+
+        _map  = static_cast<uchar*>(map);
+        _size = size;
+        return true;
+    }
+
+    [[nodiscard]] std::vector<IndexEntry> readIndex() const
+    {
+        std::vector<IndexEntry> index;
+
+        const QByteArray file = indexPath(_path).toLocal8Bit();
+        const int fd = ::open(file.constData(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return index;
+
+        struct stat info {};
+        if (fstat(fd, &info) == 0)
+        {
+            index.resize(info.st_size / sizeof(IndexEntry));
+            const auto bytes = static_cast<ssize_t>(index.size() * sizeof(IndexEntry));
+            if (pread(fd, index.data(), bytes, 0) != bytes)
+                index.clear();
+        }
+
+        close(fd);
+        return index;
+    }
+};
+
+HistoryArchive::HistoryArchive(const QString& directory, const qsizetype metrics)
+: _directory(directory)
+, _metrics(metrics)
+{
+    if (!QDir(_directory).mkpath("."))
+        qWarning() << "Failed to create history directory" << _directory;
+}
+
+HistoryArchive::~HistoryArchive()
+{
+    if (_active)
+        _active->seal();
+}
+
+const QString& HistoryArchive::directory() const
+{
+    return _directory;
+}
+
+QString HistoryArchive::activeSegment() const
+{
+    return _active ? _active->path() : QString();
+}
+
+bool HistoryArchive::append(const qint64 timestamp, const qsizetype rows, const std::span<const qreal> values)
+{
+    if (_active && _active->append(timestamp, rows, values)) return false;
+
+    const bool rotated = _active != nullptr;
+    if (_active)
+        _active->seal();
+
+    // Zero padded so the names sort by time
+    const QString path = QDir(_directory).filePath(QString("%1.seg").arg(timestamp, 20, 10, QChar('0')));
+    const qsizetype maxRecord = 1 + 2 * 10 + rows * _metrics * 10;
+
+    _active = Segment::create(path, _metrics, std::max<qsizetype>(segmentSize, sizeof(SegmentHeader) + maxRecord));
+    if (_active)
+        _active->append(timestamp, rows, values);
+
+    return rotated;
+}
+
+QStringList HistoryArchive::segments(const QString& directory, const QString& activeSegment)
+{
+    const QDir dir(directory);
+
+    // Names sort by time, so anything from the active one on is newer
+    const QString active = QFileInfo(activeSegment).fileName();
+
+    QStringList segments;
+    for (const auto& name : dir.entryList({ "*.seg" }, QDir::Files, QDir::Name))
+    {
+        if (!active.isEmpty() && name >= active) break;
+        segments.append(dir.filePath(name));
+    }
+
+    return segments;
+}
+
+void HistoryArchive::replay(const QStringList& segments, const qint64 since, const qint64 until, const Sink_t& sink)
+{
+    const std::lock_guard lock(archiveMutex);
+
+    for (const auto& path : segments)
+    {
+        const auto segment = Segment::open(path);
+        if (!segment) continue;
+
+        const auto* header = segment->header();
+        if (header->lastTime < since || header->firstTime >= until) continue;
+
+        segment->decode(since, [&sink, until](const qint64 timestamp, const qsizetype rows, const std::span<const qreal> values)
+        {
+            if (timestamp < until)
+                sink(timestamp, rows, values);
+        });
+    }
+}
+
+void HistoryArchive::maintain(
+    const QStringList& segments,
+    const qint64 dropBefore,
+    const qint64 compactBefore,
+    const qint64 interval)
+{
+    const std::lock_guard lock(archiveMutex);
+
+    for (const auto& path : segments)
+    {
+        const auto segment = Segment::open(path);
+        if (!segment) continue;
+
+        const auto* header = segment->header();
+
+        if (header->lastTime < dropBefore)
+        {
+            QFile::remove(path);
+            QFile::remove(indexPath(path));
+            continue;
+        }
+
+        if (header->compacted || header->lastTime >= compactBefore) continue;
+
+        // Mean of every interval, written to a temporary segment that then
+        // replaces the original
+        const QString compactPath = path + ".compact";
+        auto compacted = Segment::create(compactPath, header->metrics, static_cast<qsizetype>(header->used) + (1 << 16));
+        if (!compacted) continue;
+
+        qint64 bucket  = 0;
+        qsizetype rows = 0;
+        qsizetype count = 0;
+        std::vector<qreal> sums;
+        bool fits = true;
+
+        const auto flush = [&]
+        {
+            if (count == 0) return;
+
+            for (auto& sum : sums)
+                sum /= static_cast<qreal>(count);
+
+            fits  = fits && compacted->append(bucket, rows, sums);
+            count = 0;
+        };
+
+        segment->decode(header->firstTime, [&](const qint64 timestamp, const qsizetype sampleRows, const std::span<const qreal> values)
+        {
+            const qint64 start = timestamp - timestamp % interval;
+            if (start != bucket || sampleRows != rows)
+                flush();
+
+            if (count == 0)
+            {
+                bucket = start;
+                rows   = sampleRows;
+                sums.assign(values.begin(), values.end());
+            }
+            else
+                std::ranges::transform(sums, values, sums.begin(), std::plus {});
+
+            ++count;
+        });
+        flush();
+
+        compacted->header()->compacted = 1;
+        compacted->seal();
+
+        // The old index goes first. Until the new one is in place the
+        // segment has none and is scanned from the start, never read
+        // through offsets of the other file.
+        if (fits && !QFile::remove(indexPath(path)) && QFile::exists(indexPath(path)))
+            fits = false;
+
+        if (!fits
+            || std::rename(compactPath.toLocal8Bit().constData(), path.toLocal8Bit().constData()) != 0
+            || std::rename(indexPath(compactPath).toLocal8Bit().constData(), indexPath(path).toLocal8Bit().constData()) != 0)
+        {
+            qWarning() << "Failed to compact history segment" << path;
+            QFile::remove(compactPath);
+            QFile::remove(indexPath(compactPath));
+        }
+    }
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <qstring.h>
+#include <qstringlist.h>
+#include <qtypes.h>
+
+#include <functional>
+#include <memory>
+#include <span>
+#include <vector>
+
+// Append-only on-disk history of one metric group. Samples go to memory
+// mapped segment files of at most 4 MiB, <first timestamp>.seg, next to a
+// <first timestamp>.idx index of keyframe offsets by timestamp.
+//
+// Records hold the values of all rows as fixed point deltas against the
+// previous record, zigzag varint encoded. Every 64th record is a keyframe
+// with absolute values, so decoding can start at any indexed timestamp.
+//
+// Every session writes new segments, segments of earlier sessions are only
+// read, compacted or deleted by the static helpers, which may run on any
+// thread.
+class HistoryArchive
+{
+public:
+    // values[metric * rows + row]
+    using Sink_t = std::function<void(qint64 timestamp, qsizetype rows, std::span<const qreal> values)>;
+
+    HistoryArchive(const QString& directory, qsizetype metrics);
+    ~HistoryArchive();
+
+    [[nodiscard]] const QString& directory() const;
+
+    // Segment this session appends to, empty before the first sample
+    [[nodiscard]] QString activeSegment() const;
+
+    // Returns true when the sample started a new segment
+    bool append(qint64 timestamp, qsizetype rows, std::span<const qreal> values);
+
+    // Segment files in directory, oldest first. Names from activeSegment on
+    // belong to the running session and are left out.
+    [[nodiscard]] static QStringList segments(const QString& directory, const QString& activeSegment = {});
+
+    // Feeds every record in [since, until) to sink, oldest first. Waits
+    // for a running maintain(), sink must not call it.
+    static void replay(const QStringList& segments, qint64 since, qint64 until, const Sink_t& sink);
+
+    // Deletes segments ending before dropBefore and rewrites those ending
+    // before compactBefore with one mean record per interval. Concurrent
+    // calls run one after another.
+    static void maintain(const QStringList& segments, qint64 dropBefore, qint64 compactBefore, qint64 interval);
+
+private:
+    class Segment;
+
+    QString _directory;
+    qsizetype _metrics;
+
+    std::unique_ptr<Segment> _active;
+};
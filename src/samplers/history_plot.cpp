@@ -0,0 +1,294 @@
+#include "history_plot.h"
+
+#include <qdebug.h>
+#include <qsgflatcolormaterial.h>
+#include <qsggeometry.h>
+#include <qsgnode.h>
+
+#include "cpu_sampler_simple.h"
+
+#include <algorithm>
+
+// Samples per geometry node, a tick re-uploads the one or two it touches
+static constexpr qsizetype chunkSamples = 64;
+
+HistoryPlot::HistoryPlot(QQuickItem* parent)
+: QQuickItem(parent)
+{
+    setFlag(ItemHasContents);
+    setClip(true);
+}
+
+SimpleCpuDataSampler* HistoryPlot::sampler() const
+{
+    return _sampler;
+}
+
+void HistoryPlot::sampler(SimpleCpuDataSampler* sampler)
+{
+    if (_sampler == sampler) return;
+
+    if (_sampler)
+        disconnect(_sampler, nullptr, this, nullptr);
+
+    _sampler = sampler;
+
+    if (_sampler)
+    {
+        connect(_sampler, &SimpleCpuDataSampler::historyAppended, this, &QQuickItem::update);
+        connect(_sampler, &SimpleCpuDataSampler::historyReset, this, &HistoryPlot::invalidate);
+        connect(_sampler, &QObject::destroyed, this, &HistoryPlot::invalidate);
+    }
+
+    invalidate();
+    emit samplerChanged();
+}
+
+int HistoryPlot::core() const
+{
+    return _core;
+}
+
+void HistoryPlot::core(const int core)
+{
+    if (_core == core) return;
+    _core = core;
+
+    invalidate();
+    emit coreChanged();
+}
+
+QString HistoryPlot::metric() const
+{
+    return _metricName;
+}
+
+void HistoryPlot::metric(const QString& metric)
+{
+    if (_metricName == metric) return;
+
+    if (!cpuMetricFromName(metric, _metric))
+    {
+        qWarning() << "Unknown history metric" << metric;
+        return;
+    }
+
+    _metricName = metric;
+
+    invalidate();
+    emit metricChanged();
+}
+
+QColor HistoryPlot::color() const
+{
+    return _color;
+}
+
+void HistoryPlot::color(const QColor& color)
+{
+    if (_color == color) return;
+    _color   = color;
+    _recolor = true;
+
+    update();
+    emit colorChanged();
+}
+
+bool HistoryPlot::filled() const
+{
+    return _filled;
+}
+
+void HistoryPlot::filled(const bool filled)
+{
+    if (_filled == filled) return;
+    _filled = filled;
+
+    invalidate();
+    emit filledChanged();
+}
+
+qreal HistoryPlot::minimum() const
+{
+    return _minimum;
+}
+
+void HistoryPlot::minimum(const qreal minimum)
+{
+    if (_minimum == minimum) return;
+    _minimum = minimum;
+
+    // The baseline of the filled area sits at minimum
+    if (_filled)
+        invalidate();
+    else
+        update();
+
+    emit rangeChanged();
+}
+
+qreal HistoryPlot::maximum() const
+{
+    return _maximum;
+}
+
+void HistoryPlot::maximum(const qreal maximum)
+{
+    if (_maximum == maximum) return;
+    _maximum = maximum;
+
+    update();
+    emit rangeChanged();
+}
+
+void HistoryPlot::invalidate()
+{
+    _rebuild = true;
+    update();
+}
+
+void HistoryPlot::geometryChange(const QRectF& newGeometry, const QRectF& oldGeometry)
+{
+    QQuickItem::geometryChange(newGeometry, oldGeometry);
+
+    // Only the transform depends on the size
+    if (newGeometry.size() != oldGeometry.size())
+        update();
+}
+
+QSGNode* HistoryPlot::updatePaintNode(QSGNode* node, UpdatePaintNodeData*)
+{
+    const CpuHistoryStore* store = _sampler ? &_sampler->historyStore() : nullptr;
+    const qsizetype row = _core + 1;
+
+    if (!store || row < 0 || row >= store->rows() || store->size() == 0 || width() <= 0 || height() <= 0)
+    {
+        // Rows may appear later, start over once they do
+        delete node;
+        _rebuild = true;
+        return nullptr;
+    }
+
+    auto* transform = static_cast<QSGTransformNode*>(node);
+
+    if (!transform)
+    {
+        transform = new QSGTransformNode;
+        _rebuild = _recolor = true;
+    }
+
+    const qsizetype capacity  = store->capacity();
+    const qsizetype size      = store->size();
+    const quint64 sequence    = store->sequence();
+    const quint64 first       = sequence - size;
+    const int perSample       = _filled ? 2 : 1;
+    const auto baseline       = static_cast<float>(_minimum);
+
+    const auto chunk = [transform](const qsizetype index)
+    {
+        return static_cast<QSGGeometryNode*>(transform->childAtIndex(static_cast<int>(index)));
+    };
+
+    // Written in value space, the transform maps it onto the item. A sample
+    // starting a chunk also ends the previous one so the strips join.
+    const auto write = [&](const quint64 from, const quint64 to)
+    {
+        const auto place = [&](QSGGeometryNode* strip, const qsizetype at, const float x, const float y)
+        {
+            auto* vertex = strip->geometry()->vertexDataAsPoint2D() + at * perSample;
+            if (_filled)
+                (vertex++)->set(x, baseline);
+            vertex->set(x, y);
+
+            strip->markDirty(QSGNode::DirtyGeometry);
+        };
+
+        for (quint64 s = from; s < to; ++s)
+        {
+            const auto slot = static_cast<qsizetype>(s - _base);
+            const auto x    = static_cast<float>(slot);
+            const auto y    = static_cast<float>(store->value(_metric, row, static_cast<qsizetype>(s - first)));
+
+            place(chunk(slot / chunkSamples), slot % chunkSamples, x, y);
+            if (slot % chunkSamples == 0 && slot > 0)
+                place(chunk(slot / chunkSamples - 1), chunkSamples, x, y);
+        }
+    };
+
+    const qsizetype chunks = (2 * capacity + chunkSamples - 1) / chunkSamples;
+
+    if (_rebuild || _slots != chunks * chunkSamples || _uploaded < first || sequence - _base > quint64(_slots))
+    {
+        _slots = chunks * chunkSamples;
+        _base  = first;
+
+        while (transform->childCount() > chunks)
+        {
+            QSGNode* last = transform->lastChild();
+            transform->removeChildNode(last);
+            delete last;
+        }
+
+        while (transform->childCount() < chunks)
+        {
+            auto* strip = new QSGGeometryNode;
+            strip->setGeometry(new QSGGeometry(QSGGeometry::defaultAttributes_Point2D(), 0));
+            // Uploaded again only when a new sample lands in it
+            strip->geometry()->setVertexDataPattern(QSGGeometry::StaticPattern);
+            strip->setMaterial(new QSGFlatColorMaterial);
+            strip->setFlags(QSGNode::OwnsGeometry | QSGNode::OwnsMaterial);
+            transform->appendChildNode(strip);
+
+            _recolor = true;
+        }
+
+        // Slots of future samples rest on the baseline until written
+        for (qsizetype index = 0; index < chunks; ++index)
+        {
+            QSGGeometry* geometry = chunk(index)->geometry();
+            geometry->allocate(static_cast<int>((chunkSamples + 1) * perSample));
+            geometry->setDrawingMode(_filled ? QSGGeometry::DrawTriangleStrip : QSGGeometry::DrawLineStrip);
+
+            auto* vertices = geometry->vertexDataAsPoint2D();
+            for (qsizetype at = 0; at <= chunkSamples; ++at)
+                for (int i = 0; i < perSample; ++i)
+                    vertices[at * perSample + i].set(static_cast<float>(index * chunkSamples + at), baseline);
+
+            chunk(index)->markDirty(QSGNode::DirtyGeometry);
+        }
+
+        write(first, sequence);
+        _uploaded = sequence;
+        _rebuild  = false;
+    }
+    else if (_uploaded < sequence)
+    {
+        write(_uploaded, sequence);
+        _uploaded = sequence;
+    }
+
+    if (_recolor)
+    {
+        for (qsizetype index = 0; index < transform->childCount(); ++index)
+        {
+            static_cast<QSGFlatColorMaterial*>(chunk(index)->material())->setColor(_color);
+            chunk(index)->markDirty(QSGNode::DirtyMaterial);
+        }
+        _recolor = false;
+    }
+
+    // Newest sample on the right edge, capacity samples across the width
+    const qreal range  = _maximum != _minimum ? _maximum - _minimum : 1.0;
+    const qreal sx     = width() / std::max<qreal>(capacity - 1, 1);
+    const qreal sy     = -height() / range;
+    const qreal newest = static_cast<qreal>(sequence - 1 - _base);
+
+    QMatrix4x4 matrix;
+    matrix.translate(static_cast<float>(width() - sx * newest), static_cast<float>(height() - sy * _minimum));
+    matrix.scale(static_cast<float>(sx), static_cast<float>(sy));
+
+    if (matrix != transform->matrix())
+        transform->setMatrix(matrix);
+
+    return transform;
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <qcolor.h>
+#include <qpointer.h>
+#include <qqmlintegration.h>
+#include <qquickitem.h>
+
+#include "cpu_history_store.h"
+
+class SimpleCpuDataSampler;
+
+// Sparkline of one row of a sampler's history, drawn straight from its
+// CpuHistoryStore without going through a model or QVariant.
+//
+// Vertices are kept in sample sequence order across slots for twice the
+// history, split into geometry nodes of 64 samples each. A tick only writes
+// the vertices of the new samples, marks the nodes holding them dirty, so
+// only those are uploaded again, and moves the transform by one sample.
+// Slots past the newest sample lie right of the item and are clipped away.
+// The geometry is only rebuilt once its slots are used up, on a history
+// reset or when the plot settings change.
+class HistoryPlot : public QQuickItem
+{
+    Q_OBJECT
+    Q_MOC_INCLUDE("cpu_sampler_simple.h")
+    Q_PROPERTY(SimpleCpuDataSampler* sampler READ sampler WRITE sampler NOTIFY samplerChanged)
+    Q_PROPERTY(int core        READ core    WRITE core    NOTIFY coreChanged)
+    Q_PROPERTY(QString metric  READ metric  WRITE metric  NOTIFY metricChanged)
+    Q_PROPERTY(QColor color    READ color   WRITE color   NOTIFY colorChanged)
+    Q_PROPERTY(bool filled     READ filled  WRITE filled  NOTIFY filledChanged)
+    Q_PROPERTY(qreal minimum   READ minimum WRITE minimum NOTIFY rangeChanged)
+    Q_PROPERTY(qreal maximum   READ maximum WRITE maximum NOTIFY rangeChanged)
+    QML_NAMED_ELEMENT(HistoryPlot)
+
+public:
+    explicit HistoryPlot(QQuickItem* parent = nullptr);
+
+    [[nodiscard]] SimpleCpuDataSampler* sampler() const;
+    void sampler(SimpleCpuDataSampler* sampler);
+
+    // -1 plots the sampler itself
+    [[nodiscard]] int core() const;
+    void core(int core);
+
+    // "frequency", "temperature", "utilization" or "powerDraw"
+    [[nodiscard]] QString metric() const;
+    void metric(const QString& metric);
+
+    [[nodiscard]] QColor color() const;
+    void color(const QColor& color);
+
+    // Fills the area between minimum and the line
+    [[nodiscard]] bool filled() const;
+    void filled(bool filled);
+
+    // Values mapped to the bottom and the top of the item
+    [[nodiscard]] qreal minimum() const;
+    void minimum(qreal minimum);
+    [[nodiscard]] qreal maximum() const;
+    void maximum(qreal maximum);
+
+signals:
+    void samplerChanged();
+    void coreChanged();
+    void metricChanged();
+    void colorChanged();
+    void filledChanged();
+    void rangeChanged();
+
+protected:
+    QSGNode* updatePaintNode(QSGNode* node, UpdatePaintNodeData* data) override;
+    void geometryChange(const QRectF& newGeometry, const QRectF& oldGeometry) override;
+
+private:
+    QPointer<SimpleCpuDataSampler> _sampler;
+
+    int _core = -1;
+    QString _metricName = "utilization";
+    CpuHistoryStore::Metric _metric = CpuHistoryStore::Utilization;
+    QColor _color = Qt::white;
+    bool _filled  = false;
+    qreal _minimum = 0.0;
+    qreal _maximum = 1.0;
+
+    // Render state, only touched in updatePaintNode() while the GUI thread
+    // is blocked
+    bool _rebuild = true;
+    bool _recolor = true;
+    quint64 _base     = 0; // sequence number of the first vertex slot
+    quint64 _uploaded = 0; // sequence number after the last written sample
+    qsizetype _slots  = 0; // across all chunks
+
+    void invalidate();
+};
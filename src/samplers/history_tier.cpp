@@ -0,0 +1,249 @@
+#include "history_tier.h"
+
+#include <algorithm>
+#include <limits>
+
+// Slots a tier starts with, it doubles them as buckets fill
+static constexpr qsizetype initialSlots = 16;
+
+HistoryTier::HistoryTier(const qint64 duration, const qsizetype capacity, const qsizetype metrics)
+: _duration(duration)
+, _capacity(std::max<qsizetype>(capacity, 1))
+, _metrics(metrics)
+, _starts(std::min(_capacity, initialSlots))
+, _counts(_starts.capacity(), 0)
+, _min(metrics)
+, _max(metrics)
+, _mean(metrics)
+{}
+
+qint64 HistoryTier::duration() const
+{
+    return _duration;
+}
+
+qsizetype HistoryTier::capacity() const
+{
+    return _capacity;
+}
+
+qsizetype HistoryTier::stride() const
+{
+    return _starts.capacity();
+}
+
+qsizetype HistoryTier::size() const
+{
+    return _starts.size();
+}
+
+void HistoryTier::setRows(const qsizetype rows)
+{
+    // The stride stays, so rows x stride only grows or shrinks at the end
+    // and the buckets of the kept rows stay in place
+    _rows = rows;
+
+    for (qsizetype metric = 0; metric < _metrics; ++metric)
+    {
+        _min[metric].resize(rows * stride(), 0.0f);
+        _max[metric].resize(rows * stride(), 0.0f);
+        _mean[metric].resize(rows * stride(), 0.0f);
+    }
+}
+
+void HistoryTier::grow()
+{
+    const qsizetype oldStride = stride();
+    const qsizetype newStride = std::min(oldStride * 2, _capacity);
+    const qsizetype size      = _starts.size();
+
+    std::vector<quint32> counts(newStride, 0);
+    for (qsizetype i = 0; i < size; ++i)
+        counts[i] = _counts[_starts.slotOf(i)];
+
+    for (auto* columns : { &_min, &_max, &_mean })
+        for (auto& column : *columns)
+        {
+            std::vector<float> relaid(_rows * newStride, 0.0f);
+
+            for (qsizetype row = 0; row < _rows; ++row)
+                for (qsizetype i = 0; i < size; ++i)
+                    relaid[row * newStride + i] = column[row * oldStride + _starts.slotOf(i)];
+
+            column = std::move(relaid);
+        }
+
+    // Moves the starts to the front in the same order
+    _starts.setCapacity(newStride);
+    _counts = std::move(counts);
+}
+
+void HistoryTier::add(const qint64 timestamp, const std::span<const qreal* const> values)
+{
+    const qint64 start = timestamp - timestamp % _duration;
+
+    // A clock that went backwards keeps folding into the current bucket
+    if (_starts.empty() || start > _starts.last())
+    {
+        if (_starts.full() && stride() < _capacity)
+            grow();
+
+        _starts.push(start);
+
+        const qsizetype stride = this->stride();
+        const qsizetype slot   = _starts.slotOf(_starts.size() - 1);
+        _counts[slot] = 1;
+
+        for (qsizetype metric = 0; metric < _metrics; ++metric)
+        {
+            const qreal* row = values[metric];
+            float* min  = _min[metric].data() + slot;
+            float* max  = _max[metric].data() + slot;
+            float* mean = _mean[metric].data() + slot;
+
+            for (qsizetype i = 0; i < _rows; ++i)
+                min[i * stride] = max[i * stride] = mean[i * stride] = static_cast<float>(row[i]);
+        }
+        return;
+    }
+
+    const qsizetype stride = this->stride();
+    const qsizetype slot   = _starts.slotOf(_starts.size() - 1);
+    const float count      = static_cast<float>(++_counts[slot]);
+
+    for (qsizetype metric = 0; metric < _metrics; ++metric)
+    {
+        const qreal* row = values[metric];
+        float* min  = _min[metric].data() + slot;
+        float* max  = _max[metric].data() + slot;
+        float* mean = _mean[metric].data() + slot;
+
+        for (qsizetype i = 0; i < _rows; ++i)
+        {
+            const auto value = static_cast<float>(row[i]);
+            const qsizetype at = i * stride;
+
+            min[at]  = std::min(min[at], value);
+            max[at]  = std::max(max[at], value);
+            mean[at] += (value - mean[at]) / count;
+        }
+    }
+}
+
+void HistoryTier::merge(const HistoryTier& older)
+{
+    if (older._duration != _duration || older.size() == 0) return;
+
+    const qint64 first         = _starts.empty() ? std::numeric_limits<qint64>::max() : _starts.at(0);
+    const qsizetype olderCount = older.lowerBound(first);
+    const bool shared          = olderCount < older.size() && older.time(olderCount) == first;
+
+    const qsizetype total     = olderCount + _starts.size();
+    const qsizetype kept      = std::min(total, _capacity);
+    const qsizetype skipped   = total - kept;
+    const qsizetype olderRows = std::min(_rows, older._rows);
+
+    // Room for what is kept, later buckets grow it as usual
+    qsizetype stride = std::min(_capacity, initialSlots);
+    while (stride < kept)
+        stride = std::min(stride * 2, _capacity);
+
+    RingBuffer<qint64> starts(stride);
+    std::vector<quint32> counts(stride, 0);
+    std::vector<std::vector<float>> min(_metrics), max(_metrics), mean(_metrics);
+    for (qsizetype metric = 0; metric < _metrics; ++metric)
+    {
+        min[metric].assign(_rows * stride, 0.0f);
+        max[metric].assign(_rows * stride, 0.0f);
+        mean[metric].assign(_rows * stride, 0.0f);
+    }
+
+    for (qsizetype i = 0; i < kept; ++i)
+    {
+        const qsizetype index  = skipped + i;
+        const bool fromOlder   = index < olderCount;
+        const HistoryTier& source = fromOlder ? older : *this;
+        const qsizetype at     = fromOlder ? index : index - olderCount;
+        const qsizetype slot   = source._starts.slotOf(at);
+        const qsizetype rows   = fromOlder ? olderRows : _rows;
+
+        starts.push(source._starts.at(at));
+        counts[i] = source._counts[slot];
+
+        for (qsizetype metric = 0; metric < _metrics; ++metric)
+            for (qsizetype row = 0; row < rows; ++row)
+            {
+                const qsizetype from = row * source.stride() + slot;
+                const qsizetype to   = row * stride + i;
+
+                min[metric][to]  = source._min[metric][from];
+                max[metric][to]  = source._max[metric][from];
+                mean[metric][to] = source._mean[metric][from];
+            }
+    }
+
+    // Both hold samples of the bucket the live history started in
+    if (const qsizetype i = olderCount - skipped; shared && i >= 0 && i < kept)
+    {
+        const qsizetype slot  = older._starts.slotOf(olderCount);
+        const float ownCount  = static_cast<float>(counts[i]);
+        const float sumCount  = ownCount + static_cast<float>(older._counts[slot]);
+
+        counts[i] += older._counts[slot];
+
+        for (qsizetype metric = 0; metric < _metrics; ++metric)
+            for (qsizetype row = 0; row < olderRows; ++row)
+            {
+                const qsizetype from = row * older.stride() + slot;
+                const qsizetype to   = row * stride + i;
+
+                min[metric][to]  = std::min(min[metric][to], older._min[metric][from]);
+                max[metric][to]  = std::max(max[metric][to], older._max[metric][from]);
+                mean[metric][to] = (mean[metric][to] * ownCount
+                                    + older._mean[metric][from] * (sumCount - ownCount)) / sumCount;
+            }
+    }
+
+    _starts = std::move(starts);
+    _counts = std::move(counts);
+    _min    = std::move(min);
+    _max    = std::move(max);
+    _mean   = std::move(mean);
+}
+
+HistoryTier::Bucket HistoryTier::bucket(const qsizetype metric, const qsizetype row, const qsizetype index) const
+{
+    const qsizetype at = row * stride() + _starts.slotOf(index);
+
+    return {
+        .time = _starts.at(index),
+        .min  = _min[metric][at],
+        .max  = _max[metric][at],
+        .mean = _mean[metric][at],
+    };
+}
+
+qint64 HistoryTier::time(const qsizetype index) const
+{
+    return _starts.at(index);
+}
+
+qsizetype HistoryTier::lowerBound(const qint64 time) const
+{
+    qsizetype first = 0;
+    qsizetype count = _starts.size();
+
+    while (count > 0)
+    {
+        const qsizetype step = count / 2;
+        if (_starts.at(first + step) + _duration <= time)
+        {
+            first += step + 1;
+            count -= step + 1;
+        }
+        else
+            count = step;
+    }
+
+    return first;
+}
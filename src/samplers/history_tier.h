@@ -0,0 +1,67 @@
+#pragma once
+
+#include <qtypes.h>
+
+#include <span>
+#include <vector>
+
+#include "../util/ring_buffer.h"
+
+// Downsampled history of every row of a CpuHistoryStore. Samples are folded
+// into fixed duration buckets as they are appended, each bucket keeps the
+// min, max and mean of every row and metric. Capacity is fixed, so a tier
+// covers duration * capacity milliseconds in bounded memory. Storage grows
+// with the buckets filled, a tier of days costs little in its first hour.
+class HistoryTier
+{
+public:
+    struct Bucket
+    {
+        qint64 time = 0; // start of the bucket
+        float  min  = 0;
+        float  max  = 0;
+        float  mean = 0;
+    };
+
+    HistoryTier(qint64 duration, qsizetype capacity, qsizetype metrics);
+
+    [[nodiscard]] qint64 duration() const;
+    [[nodiscard]] qsizetype capacity() const;
+    [[nodiscard]] qsizetype size() const;
+
+    // New rows start with empty buckets
+    void setRows(qsizetype rows);
+
+    // values[metric][row] of one sample
+    void add(qint64 timestamp, std::span<const qreal* const> values);
+
+    // Puts the buckets of older that precede the first bucket here in
+    // front, a bucket both hold is combined. Keeps the newest that fit.
+    void merge(const HistoryTier& older);
+
+    // index 0 is the oldest bucket
+    [[nodiscard]] Bucket bucket(qsizetype metric, qsizetype row, qsizetype index) const;
+    [[nodiscard]] qint64 time(qsizetype index) const;
+
+    // Index of the first bucket that ends after time, size() if none
+    [[nodiscard]] qsizetype lowerBound(qint64 time) const;
+
+private:
+    const qint64 _duration;
+    const qsizetype _capacity;
+    const qsizetype _metrics;
+    qsizetype _rows = 0;
+
+    // Slots allocated, up to _capacity. The ring grows with them.
+    RingBuffer<qint64> _starts;
+    std::vector<quint32> _counts; // samples per bucket, by slot
+
+    // Per metric, laid out rows x stride() like the store columns
+    std::vector<std::vector<float>> _min;
+    std::vector<std::vector<float>> _max;
+    std::vector<std::vector<float>> _mean;
+
+    [[nodiscard]] qsizetype stride() const;
+    // Doubles the slots, up to _capacity, keeping the buckets in order
+    void grow();
+};
@@ -0,0 +1,139 @@
+// Runs CpuCollector against the recorded fixture trees and reports per-stage
+// and end-to-end latency plus heap allocations per tick.
+// Usage: bench_collector [iterations] [fixture-dir...]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "../collection/cpu_collector.h"
+
+//# Allocation counting, glibc only. Qt containers allocate through malloc,
+//# so counting operator new alone would miss most of them.
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* __libc_calloc(size_t count, size_t size);
+extern "C" void* __libc_realloc(void* ptr, size_t size);
+
+static thread_local quint64 allocations = 0;
+
+extern "C" void* malloc(const size_t size) noexcept
+{
+    ++allocations;
+    return __libc_malloc(size);
+}
+
+extern "C" void* calloc(const size_t count, const size_t size) noexcept
+{
+    ++allocations;
+    return __libc_calloc(count, size);
+}
+
+extern "C" void* realloc(void* ptr, const size_t size) noexcept
+{
+    ++allocations;
+    return __libc_realloc(ptr, size);
+}
+
+using Clock_t = std::chrono::steady_clock;
+
+struct Sample
+{
+    double  ns          = 0;
+    quint64 allocations = 0;
+};
+
+struct StageTotals
+{
+    std::vector<std::string> order;
+    std::map<std::string, Sample> stages;
+    Sample total;
+};
+
+static void report(const char* title, const StageTotals& totals, const int ticks)
+{
+    std::printf("  %s\n", title);
+    for (const auto& name : totals.order)
+    {
+        const auto& stage = totals.stages.at(name);
+        std::printf("    %-10s %12.1f us %10.1f allocs\n", name.c_str(), stage.ns / ticks / 1000, double(stage.allocations) / ticks);
+    }
+    std::printf("    %-10s %12.1f us %10.1f allocs\n", "total", totals.total.ns / ticks / 1000, double(totals.total.allocations) / ticks);
+}
+
+static void bench(const std::string& root, const int iterations)
+{
+    CpuCollector collector(QString::fromStdString(root));
+
+    StageTotals totals;
+    Clock_t::time_point stageStart;
+    quint64 stageAllocations = 0;
+
+    collector.setStageProbe([&](const std::string_view stage)
+    {
+        const auto now = Clock_t::now();
+        const std::string name(stage);
+
+        if (!totals.stages.contains(name))
+            totals.order.push_back(name);
+
+        auto& sample = totals.stages[name];
+        sample.ns          += std::chrono::duration<double, std::nano>(now - stageStart).count();
+        sample.allocations += allocations - stageAllocations;
+
+        stageAllocations = allocations;
+        stageStart       = Clock_t::now();
+    });
+
+    Data_Cpu data;
+
+    const auto tick = [&]
+    {
+        const quint64 allocationsBefore = allocations;
+        stageAllocations = allocationsBefore;
+
+        const auto start = Clock_t::now();
+        stageStart = start;
+
+        collector.collect(CpuCollector::Options {}, data);
+
+        totals.total.ns          += std::chrono::duration<double, std::nano>(Clock_t::now() - start).count();
+        totals.total.allocations += allocations - allocationsBefore;
+
+        return data.cpus.size();
+    };
+
+    std::printf("%s\n", root.c_str());
+
+    // The first tick opens every file and parses the topology
+    tick();
+    report("first tick", totals, 1);
+    std::printf("    syscalls   %12llu\n", static_cast<unsigned long long>(collector.syscallsPerTick()));
+
+    totals = {};
+    for (int i = 0; i < iterations; ++i)
+        tick();
+
+    report("steady state", totals, iterations);
+    std::printf("    syscalls   %12llu\n\n", static_cast<unsigned long long>(collector.syscallsPerTick()));
+}
+
+int main(int argc, char* argv[])
+{
+    const int iterations = argc > 1 ? std::atoi(argv[1]) : 200;
+
+    std::vector<std::string> roots;
+    for (int i = 2; i < argc; ++i)
+        roots.emplace_back(argv[i]);
+
+    if (roots.empty())
+        for (const auto* name : {"cpu4", "cpu64", "cpu256"})
+            roots.push_back(std::string(FIXTURE_DIR) + "/" + name);
+
+    for (const auto& root : roots)
+        bench(root, iterations);
+
+    return 0;
+}
@@ -0,0 +1,89 @@
+// Micro-benchmark for parseProcStat against a synthetic /proc/stat.
+// Usage: bench_stat_parser [cpus] [iterations]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include "../collection/proc_stat_parser.h"
+
+static std::string makeProcStat(const int cpus, const bool withIrqs)
+{
+    std::string out;
+
+    const auto cpuLine = [&out](const std::string& name, const quint64 seed)
+    {
+        out += name;
+        for (quint64 field = 0; field < 10; ++field)
+            out += ' ' + std::to_string(seed * 7919 + field * 104729);
+        out += '\n';
+    };
+
+    cpuLine("cpu", 1);
+    for (int i = 0; i < cpus; ++i)
+        cpuLine("cpu" + std::to_string(i), i + 2);
+
+    if (!withIrqs)
+        return out;
+
+    // The intr line has one column per irq, a few hundred on real machines
+    out += "intr 123456789";
+    for (int i = 0; i < 512; ++i)
+        out += ' ' + std::to_string(i % 7 == 0 ? i * 31337 : 0);
+    out += '\n';
+
+    out += "ctxt 987654321\n"
+           "btime 1700000000\n"
+           "processes 424242\n"
+           "procs_running 3\n"
+           "procs_blocked 0\n"
+           "softirq 5555 1 2 3 4 5 6 7 8 9 10\n";
+
+    return out;
+}
+
+// Returns the average time of one parse in nanoseconds
+static double measure(const std::string& raw, Data_Cpu& data, const Mappings_t& mappings, const int iterations)
+{
+    const QByteArrayView view(raw.data(), static_cast<qsizetype>(raw.size()));
+
+    // Warm up, also grows the interrupt vectors to their final size
+    parseProcStat(view, data, mappings);
+
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i)
+        parseProcStat(view, data, mappings);
+    const auto end = std::chrono::steady_clock::now();
+
+    return std::chrono::duration<double, std::nano>(end - start).count() / iterations;
+}
+
+int main(int argc, char* argv[])
+{
+    const int cpus       = argc > 1 ? std::atoi(argv[1]) : 256;
+    const int iterations = argc > 2 ? std::atoi(argv[2]) : 20000;
+
+    Data_Cpu data;
+    Mappings_t mappings;
+
+    auto& cpu = data.cpus.emplace_back();
+    cpu.cores.resize(cpus);
+    for (qsizetype i = 0; i < cpus; ++i)
+        mappings.insert({i, {0, i}});
+
+    const std::string cpuLines = makeProcStat(cpus, false);
+    const std::string full     = makeProcStat(cpus, true);
+
+    const double cpuLinesNs = measure(cpuLines, data, mappings, iterations);
+    const double fullNs     = measure(full, data, mappings, iterations);
+
+    std::printf("cpus:              %d\n", cpus);
+    std::printf("bytes:             %zu\n", full.size());
+    std::printf("ns per cpu line:   %.1f\n", cpuLinesNs / (cpus + 1));
+    std::printf("ns per file:       %.1f\n", fullNs);
+    std::printf("checksum:          %llu\n",
+        static_cast<unsigned long long>(cpu.cores.last().stats.total() + data.globalStats.interrupts.size()));
+
+    return 0;
+}
@@ -0,0 +1,29 @@
+#!/bin/bash
+# Copies the procfs/sysfs files the collectors read into a fixture tree.
+# Usage: ./capture.sh <destination>
+set -e
+
+dest="$1"
+if [ -z "$dest" ]; then
+    echo "Usage: $0 <destination>"
+    exit 1
+fi
+
+copy() {
+    for file in "$@"; do
+        [ -r "$file" ] || continue
+        mkdir -p "$dest/$(dirname "$file")"
+        cat "$file" > "$dest/$file"
+    done
+}
+
+copy /proc/cpuinfo /proc/stat /proc/loadavg /sys/devices/system/cpu/online
+copy /sys/devices/system/cpu/cpu[0-9]*/cpufreq/{cpuinfo_min_freq,cpuinfo_max_freq,scaling_cur_freq}
+copy /sys/devices/system/cpu/cpu[0-9]*/topology/{physical_package_id,core_id}
+copy /sys/class/hwmon/hwmon*/{name,temp*_label,temp*_input}
+copy /sys/class/thermal/thermal_zone*/{type,temp}
+copy /sys/class/powercap/intel-rapl:*/{name,energy_uj,max_energy_range_uj}
+copy /sys/class/backlight/*/{brightness,max_brightness}
+copy /sys/class/leds/*/{brightness,max_brightness,multi_index,multi_intensity,trigger}
+
+echo "Captured into $dest"
@@ -0,0 +1,249 @@
+#!/usr/bin/env python3
+# Writes the procfs/sysfs fixture trees used by bench_collector. They follow
+# the layout of captures from a 4-cpu laptop, a 64-cpu workstation and a
+# 256-cpu dual socket server, with deterministic counter values so results
+# stay comparable between runs. Use capture.sh to record a live machine.
+#
+#   generate.py [machine...]                   writes the trees
+#   generate.py --energy-tick N [machine...]   only rewrites the RAPL energy
+#                                              counters as they read N ticks
+#                                              after the first one
+#
+# Energy ticks are ENERGY_TICK_US apart and every counter wraps at its
+# max_energy_range_uj between tick 2 and 3.
+
+import os
+import shutil
+import sys
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+
+INTEL_FLAGS = (
+    "fpu vme de pse tsc msr pae mce cx8 apic sep mtrr pge mca cmov pat pse36 clflush dts acpi mmx fxsr "
+    "sse sse2 ss ht tm pbe syscall nx pdpe1gb rdtscp lm constant_tsc art arch_perfmon pebs bts rep_good "
+    "nopl xtopology nonstop_tsc cpuid aperfmperf tsc_known_freq pni pclmulqdq dtes64 monitor ds_cpl vmx "
+    "est tm2 ssse3 sdbg fma cx16 xtpr pdcm pcid sse4_1 sse4_2 x2apic movbe popcnt tsc_deadline_timer aes "
+    "xsave avx f16c rdrand lahf_lm abm 3dnowprefetch cpuid_fault epb cat_l3 cat_l2 cdp_l3 invpcid_single "
+    "intel_ppin ssbd mba ibrs ibpb stibp ibrs_enhanced tpr_shadow flexpriority ept vpid ept_ad fsgsbase "
+    "tsc_adjust bmi1 avx2 smep bmi2 erms invpcid cqm rdt_a avx512f avx512dq rdseed adx smap avx512ifma "
+    "clflushopt clwb intel_pt avx512cd sha_ni avx512bw avx512vl xsaveopt xsavec xgetbv1 xsaves cqm_llc "
+    "cqm_occup_llc cqm_mbm_total cqm_mbm_local split_lock_detect avx_vnni avx512_bf16 wbnoinvd dtherm ida "
+    "arat pln pts hwp hwp_act_window hwp_epp hwp_pkg_req avx512vbmi umip pku ospke waitpkg avx512_vbmi2 "
+    "gfni vaes vpclmulqdq avx512_vnni avx512_bitalg tme avx512_vpopcntdq la57 rdpid bus_lock_detect "
+    "cldemote movdiri movdir64b enqcmd fsrm md_clear serialize tsxldtrk pconfig arch_lbr ibt amx_bf16 "
+    "avx512_fp16 amx_tile amx_int8 flush_l1d arch_capabilities"
+)
+
+AMD_FLAGS = (
+    "fpu vme de pse tsc msr pae mce cx8 apic sep mtrr pge mca cmov pat pse36 clflush mmx fxsr sse sse2 ht "
+    "syscall nx mmxext fxsr_opt pdpe1gb rdtscp lm constant_tsc rep_good amd_lbr_v2 nopl nonstop_tsc cpuid "
+    "extd_apicid aperfmperf rapl pni pclmulqdq monitor ssse3 fma cx16 sse4_1 sse4_2 x2apic movbe popcnt aes "
+    "xsave avx f16c rdrand lahf_lm cmp_legacy svm extapic cr8_legacy abm sse4a misalignsse 3dnowprefetch "
+    "osvw ibs skinit wdt tce topoext perfctr_core perfctr_nb bpext perfctr_llc mwaitx cpb cat_l3 cdp_l3 "
+    "hw_pstate ssbd mba perfmon_v2 ibrs ibpb stibp ibrs_enhanced vmmcall fsgsbase bmi1 avx2 smep bmi2 erms "
+    "invpcid cqm rdt_a avx512f avx512dq rdseed adx smap avx512ifma clflushopt clwb avx512cd sha_ni avx512bw "
+    "avx512vl xsaveopt xsavec xgetbv1 xsaves cqm_llc cqm_occup_llc cqm_mbm_total cqm_mbm_local avx512_bf16 "
+    "clzero irperf xsaveerptr rdpru wbnoinvd cppc arat npt lbrv svm_lock nrip_save tsc_scale vmcb_clean "
+    "flushbyasid decodeassists pausefilter pfthreshold avic v_vmsave_vmload vgif x2avic v_spec_ctrl vnmi "
+    "avx512vbmi umip pku ospke avx512_vbmi2 gfni vaes vpclmulqdq avx512_vnni avx512_bitalg avx512_vpopcntdq "
+    "rdpid overflow_recov succor smca fsrm flush_l1d"
+)
+
+MACHINES = {
+    # name: (model name, vendor, packages, cores per package, threads per core, min/max kHz, flags)
+    "cpu4":   ("Intel(R) Core(TM) i5-7200U CPU @ 2.50GHz", "GenuineIntel", 1, 2, 2, (400000, 3100000), INTEL_FLAGS),
+    "cpu64":  ("AMD Ryzen Threadripper PRO 7975WX 32-Cores", "AuthenticAMD", 1, 32, 2, (545000, 5350000), AMD_FLAGS),
+    "cpu256": ("Intel(R) Xeon(R) Platinum 8592+", "GenuineIntel", 2, 64, 2, (800000, 3900000), INTEL_FLAGS),
+}
+
+
+def write(root, path, content):
+    full = os.path.join(root, path.lstrip("/"))
+    os.makedirs(os.path.dirname(full), exist_ok=True)
+    with open(full, "w") as f:
+        f.write(content)
+
+
+def logical_cpus(packages, cores, threads):
+    # Linux numbers the first thread of every core first, then the siblings
+    cpus = []
+    for thread in range(threads):
+        for package in range(packages):
+            for core in range(cores):
+                cpus.append((package, core, thread))
+    return cpus
+
+
+def cpuinfo(model, vendor, packages, cores, threads, khz, flags):
+    out = []
+    for index, (package, core, thread) in enumerate(logical_cpus(packages, cores, threads)):
+        mhz = khz[0] / 1000 + (index * 37) % int((khz[1] - khz[0]) / 1000)
+        out.append(
+            f"processor\t: {index}\n"
+            f"vendor_id\t: {vendor}\n"
+            f"cpu family\t: {6 if vendor == 'GenuineIntel' else 25}\n"
+            f"model\t\t: {207 if vendor == 'GenuineIntel' else 24}\n"
+            f"model name\t: {model}\n"
+            f"stepping\t: 2\n"
+            f"microcode\t: 0x21000240\n"
+            f"cpu MHz\t\t: {mhz:.3f}\n"
+            f"cache size\t: {2048 * cores} KB\n"
+            f"physical id\t: {package}\n"
+            f"siblings\t: {cores * threads}\n"
+            f"core id\t\t: {core}\n"
+            f"cpu cores\t: {cores}\n"
+            f"apicid\t\t: {package * 256 + core * 2 + thread}\n"
+            f"initial apicid\t: {package * 256 + core * 2 + thread}\n"
+            f"fpu\t\t: yes\n"
+            f"fpu_exception\t: yes\n"
+            f"cpuid level\t: 32\n"
+            f"wp\t\t: yes\n"
+            f"flags\t\t: {flags}\n"
+            f"bugs\t\t: spectre_v1 spectre_v2 spec_store_bypass swapgs eibrs_pbrsb bhi\n"
+            f"bogomips\t: {khz[1] / 500:.2f}\n"
+            f"clflush size\t: 64\n"
+            f"cache_alignment\t: 64\n"
+            f"address sizes\t: 46 bits physical, 57 bits virtual\n"
+            f"power management:\n"
+            f"\n"
+        )
+    return "".join(out)
+
+
+def stat(count):
+    def line(name, seed):
+        user = 1000000 + seed * 7919
+        return (f"{name} {user} {seed * 13} {user // 4} {user * 9} {seed * 31} 0 {seed * 7} 0 0 0\n")
+
+    out = [line("cpu ", 1)]
+    out += [line(f"cpu{i}", i + 2) for i in range(count)]
+    out.append("intr 987654321 " + " ".join(str(i * 4099 if i % 5 == 0 else 0) for i in range(64 + count * 4)) + "\n")
+    out.append("ctxt 1234567890\n")
+    out.append("btime 1760000000\n")
+    out.append("processes 4242424\n")
+    out.append("procs_running 3\n")
+    out.append("procs_blocked 0\n")
+    out.append("softirq 55555555 12 3456 789 1011 1213 0 1415 1617 18 1920\n")
+    return "".join(out)
+
+
+def sensors(root, vendor, packages, cores):
+    # An unrelated sensor first, like acpitz on most laptops
+    write(root, "/sys/class/hwmon/hwmon0/name", "acpitz\n")
+    write(root, "/sys/class/hwmon/hwmon0/temp1_input", "27800\n")
+    write(root, "/sys/class/thermal/thermal_zone0/type", "acpitz\n")
+    write(root, "/sys/class/thermal/thermal_zone0/temp", "27800\n")
+
+    for package in range(packages):
+        hwmon = f"/sys/class/hwmon/hwmon{package + 1}/"
+        zone = f"/sys/class/thermal/thermal_zone{package + 1}/"
+
+        if vendor == "GenuineIntel":
+            # coretemp numbers its inputs from 2 + core id, the package is temp1
+            write(root, hwmon + "name", "coretemp\n")
+            write(root, hwmon + "temp1_label", f"Package id {package}\n")
+            write(root, hwmon + "temp1_input", f"{52000 + package * 3000}\n")
+            for core in range(cores):
+                write(root, hwmon + f"temp{core + 2}_label", f"Core {core}\n")
+                write(root, hwmon + f"temp{core + 2}_input", f"{44000 + (core * 1000) % 9000 + package * 2000}\n")
+
+            write(root, zone + "type", "x86_pkg_temp\n")
+            write(root, zone + "temp", f"{52000 + package * 3000}\n")
+        else:
+            # k10temp has no per-core sensors, only the control and ccd ones
+            write(root, hwmon + "name", "k10temp\n")
+            write(root, hwmon + "temp1_label", "Tctl\n")
+            write(root, hwmon + "temp1_input", f"{61250 + package * 1000}\n")
+            for ccd in range(cores // 8):
+                write(root, hwmon + f"temp{ccd + 3}_label", f"Tccd{ccd + 1}\n")
+                write(root, hwmon + f"temp{ccd + 3}_input", f"{55000 + ccd * 750}\n")
+
+
+# RAPL zones per machine, (name, watts) with the package first
+RAPL_INTEL = [("package", 15.0), ("core", 9.5), ("uncore", 1.25), ("dram", 2.0)]
+RAPL_AMD = [("package", 142.0), ("core", 96.0)]
+
+ENERGY_RANGE_UJ = 262143328850
+ENERGY_TICK_US = 2000000
+
+
+def rapl_zones(vendor, packages):
+    domains = RAPL_INTEL if vendor == "GenuineIntel" else RAPL_AMD
+    for package in range(packages):
+        base = f"/sys/class/powercap/intel-rapl:{package}"
+        yield base + "/", f"package-{package}", domains[0][1]
+        for index, (name, watts) in enumerate(domains[1:]):
+            yield f"{base}:{index}/", name, watts
+
+
+def energy(root, vendor, packages, tick):
+    for zone, name, watts in rapl_zones(vendor, packages):
+        per_tick = int(watts * ENERGY_TICK_US)
+        start = ENERGY_RANGE_UJ - 2 * per_tick - 4242
+        write(root, zone + "energy_uj", f"{(start + tick * per_tick) % ENERGY_RANGE_UJ}\n")
+
+
+def rapl(root, vendor, packages):
+    for zone, name, watts in rapl_zones(vendor, packages):
+        write(root, zone + "name", f"{name}\n")
+        write(root, zone + "max_energy_range_uj", f"{ENERGY_RANGE_UJ}\n")
+
+    energy(root, vendor, packages, 0)
+
+
+def machine(name, model, vendor, packages, cores, threads, khz, flags):
+    root = os.path.join(HERE, name)
+    shutil.rmtree(root, ignore_errors=True)
+
+    count = packages * cores * threads
+
+    write(root, "/proc/cpuinfo", cpuinfo(model, vendor, packages, cores, threads, khz, flags))
+    write(root, "/proc/stat", stat(count))
+    write(root, "/proc/loadavg", f"{count / 64:.2f} {count / 80:.2f} {count / 100:.2f} 3/{count * 4} 424242\n")
+    write(root, "/sys/devices/system/cpu/online", f"0-{count - 1}\n")
+
+    for index, (package, core, thread) in enumerate(logical_cpus(packages, cores, threads)):
+        base = f"/sys/devices/system/cpu/cpu{index}/cpufreq/"
+        write(root, base + "cpuinfo_min_freq", f"{khz[0]}\n")
+        write(root, base + "cpuinfo_max_freq", f"{khz[1]}\n")
+        write(root, base + "scaling_cur_freq", f"{khz[0] + (index * 37000) % (khz[1] - khz[0])}\n")
+
+        base = f"/sys/devices/system/cpu/cpu{index}/topology/"
+        write(root, base + "physical_package_id", f"{package}\n")
+        write(root, base + "core_id", f"{core}\n")
+
+    sensors(root, vendor, packages, cores)
+    rapl(root, vendor, packages)
+
+    write(root, "/sys/class/leds/input3::capslock/brightness", "0\n")
+    write(root, "/sys/class/leds/input3::capslock/max_brightness", "1\n")
+    write(root, "/sys/class/leds/input3::capslock/trigger", "none kbd-capslock [input3-capslock] timer pattern\n")
+
+    if name == "cpu4":
+        write(root, "/sys/class/backlight/intel_backlight/brightness", "9600\n")
+        write(root, "/sys/class/backlight/intel_backlight/max_brightness", "19200\n")
+        write(root, "/sys/class/leds/tpacpi::kbd_backlight/brightness", "1\n")
+        write(root, "/sys/class/leds/tpacpi::kbd_backlight/max_brightness", "2\n")
+        write(root, "/sys/class/leds/tpacpi::kbd_backlight/trigger", "[none] timer pattern\n")
+        write(root, "/sys/class/leds/rgb:kbd_zone0/brightness", "255\n")
+        write(root, "/sys/class/leds/rgb:kbd_zone0/max_brightness", "255\n")
+        write(root, "/sys/class/leds/rgb:kbd_zone0/multi_index", "red green blue\n")
+        write(root, "/sys/class/leds/rgb:kbd_zone0/multi_intensity", "255 128 0\n")
+
+
+def main():
+    args = sys.argv[1:]
+
+    if args[:1] == ["--energy-tick"]:
+        tick = int(args[1])
+        for name in args[2:] or MACHINES.keys():
+            model, vendor, packages, *_ = MACHINES[name]
+            energy(os.path.join(HERE, name), vendor, packages, tick)
+        return
+
+    for name in args or MACHINES.keys():
+        machine(name, *MACHINES[name])
+
+
+if __name__ == "__main__":
+    main()
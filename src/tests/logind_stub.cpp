@@ -0,0 +1,108 @@
+// Stand-in for logind's SetBrightness on the session bus. Writes the value
+// to <root>/sys/class/<class>/<id>/brightness like logind does on the real
+// tree, so the controller sees its own writes come back through the polling
+// BrightnessNotifier, which is all it has against a fixture root.
+// Usage: logind_stub <fixture-root> [delay-ms]
+//
+//   dbus-run-session -- sh -c 'logind_stub fixtures/cpu4 &
+//       HARDWARE_CONTROLS_BUS=session HARDWARE_CONTROLS_ROOT=fixtures/cpu4 the_test'
+//
+// Ids starting with "fail" are answered with an error, delay-ms holds every
+// reply back to make pipelining and timeouts observable.
+
+#if defined(HAVE_LIBSYSTEMD)
+# include <systemd/sd-bus.h>
+#elif defined(HAVE_LIBELOGIND)
+# include <elogind/sd-bus.h>
+#elif defined(HAVE_BASU)
+# include <basu/sd-bus.h>
+#else
+# error "No dbus provider found"
+#endif
+
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+static std::string root;
+static useconds_t delay = 0;
+static unsigned long calls = 0;
+
+static int setBrightness(sd_bus_message* call, void*, sd_bus_error* error)
+{
+    const char* className = nullptr;
+    const char* id        = nullptr;
+    uint32_t value        = 0;
+
+    if (const int r = sd_bus_message_read(call, "ssu", &className, &id, &value); r < 0)
+        return r;
+
+    ++calls;
+    std::printf("SetBrightness %s %s %u (#%lu)\n", className, id, value, calls);
+    std::fflush(stdout);
+
+    if (delay)
+        usleep(delay);
+
+    if (std::strncmp(id, "fail", 4) == 0)
+        return sd_bus_error_set(error, "org.freedesktop.DBus.Error.Failed", "Scripted failure");
+
+    const std::string path = root + "/sys/class/" + className + "/" + id + "/brightness";
+    FILE* file = std::fopen(path.c_str(), "w");
+    if (!file)
+        return sd_bus_error_set_errnof(error, errno, "Can't open %s", path.c_str());
+
+    std::fprintf(file, "%u\n", value);
+    std::fclose(file);
+
+    return sd_bus_reply_method_return(call, "");
+}
+
+static const sd_bus_vtable sessionVtable[] = {
+    SD_BUS_VTABLE_START(0),
+    SD_BUS_METHOD("SetBrightness", "ssu", "", setBrightness, SD_BUS_VTABLE_UNPRIVILEGED),
+    SD_BUS_VTABLE_END,
+};
+
+int main(const int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        std::fprintf(stderr, "Usage: %s <fixture-root> [delay-ms]\n", argv[0]);
+        return 1;
+    }
+
+    root  = argv[1];
+    delay = argc > 2 ? static_cast<useconds_t>(std::atoi(argv[2])) * 1000 : 0;
+
+    sd_bus* bus = nullptr;
+    int r = sd_bus_open_user(&bus);
+    if (r >= 0) r = sd_bus_add_object_vtable(bus, nullptr, "/org/freedesktop/login1/session/auto",
+                                             "org.freedesktop.login1.Session", sessionVtable, nullptr);
+    if (r >= 0) r = sd_bus_request_name(bus, "org.freedesktop.login1", 0);
+
+    if (r < 0)
+    {
+        std::fprintf(stderr, "Failed to set up the session bus: %s\n", std::strerror(-r));
+        return 1;
+    }
+
+    for (;;)
+    {
+        r = sd_bus_process(bus, nullptr);
+        if (r < 0) break;
+        if (r > 0) continue;
+
+        r = sd_bus_wait(bus, UINT64_MAX);
+        if (r < 0) break;
+    }
+
+    std::fprintf(stderr, "Bus failed: %s\n", std::strerror(-r));
+    sd_bus_unref(bus);
+    return 1;
+}
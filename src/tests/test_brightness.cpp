@@ -0,0 +1,103 @@
+// Checks Brightness against a scripted sysfs tree: a LED blinking through
+// the kernel timer trigger stops once current is set to 0.
+// Usage: test_brightness
+
+#include <qcoreapplication.h>
+#include <qelapsedtimer.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#include "../brightness.h"
+
+static int failures = 0;
+
+static void expect(const bool condition, const char* what)
+{
+    if (condition) return;
+
+    std::printf("FAIL %s\n", what);
+    ++failures;
+}
+
+static void write(const std::filesystem::path& path, const std::string& content)
+{
+    std::filesystem::create_directories(path.parent_path());
+    std::ofstream(path) << content << '\n';
+}
+
+static std::string read(const std::filesystem::path& path)
+{
+    std::string content;
+    std::getline(std::ifstream(path), content);
+    return content;
+}
+
+int main(int argc, char* argv[])
+{
+    using namespace hw_monitor;
+
+    QCoreApplication app(argc, argv);
+
+    std::string root = (std::filesystem::temp_directory_path() / "test_brightness.XXXXXX").string();
+    if (!mkdtemp(root.data()))
+    {
+        std::printf("FAIL can't create the fixture tree\n");
+        return 1;
+    }
+
+    // The attributes the timer trigger adds are there from the start, udev
+    // has nothing to open up here
+    const std::filesystem::path led = std::filesystem::path(root) / "sys/class/leds/kbd";
+    std::filesystem::create_directories(std::filesystem::path(root) / "sys/class/backlight");
+    write(led / "brightness", "3");
+    write(led / "max_brightness", "3");
+    write(led / "trigger", "[none] timer pattern");
+    write(led / "delay_on", "0");
+    write(led / "delay_off", "0");
+
+    Brightness brightness(nullptr, QString::fromStdString(root));
+    brightness.updateDelay(0);
+
+    // Discovery runs on a thread of its own
+    QElapsedTimer waited;
+    waited.start();
+    while (brightness.leds().isEmpty() && waited.elapsed() < 5000)
+        QCoreApplication::processEvents(QEventLoop::AllEvents, 10);
+
+    expect(brightness.leds().size() == 1, "the LED is discovered");
+    if (brightness.leds().isEmpty())
+    {
+        std::filesystem::remove_all(root);
+        return 1;
+    }
+
+    BrightnessEntry* entry = brightness.leds().first();
+
+    entry->blink(100, 200);
+
+    expect(entry->trigger() == "timer", "blink runs in the kernel");
+    // sysfs takes a write whole, the fixture file keeps what followed
+    expect(read(led / "trigger").starts_with("timer"), "timer trigger written");
+    expect(read(led / "delay_on") == "100", "delay_on written");
+    expect(entry->current() == 0, "a new trigger turns the LED off");
+
+    const qint64 issued = brightness.writesIssued();
+    entry->current(0);
+
+    expect(entry->trigger() == "none", "current 0 ends the blinking");
+    expect(brightness.writesIssued() == issued + 1, "current 0 is written although it didn't change");
+#ifndef ENABLE_LOGIND
+    expect(read(led / "brightness") == "0", "0 reaches the device");
+#endif
+
+    std::filesystem::remove_all(root);
+
+    if (failures == 0)
+        std::printf("All checks passed\n");
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,139 @@
+// Checks PowerCollector against a scripted powercap tree: watts between two
+// ticks, a counter wrapping at max_energy_range_uj, unreadable ones and one
+// that can't be opened.
+// Usage: test_power_collector
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#include <unistd.h>
+
+#include "../collection/power_collector.h"
+
+static constexpr quint64 energyRange = 262143328850;
+static constexpr qint64  tickUs      = 2000000;
+
+static int failures = 0;
+
+static void expect(const bool condition, const char* what)
+{
+    if (condition) return;
+
+    std::printf("FAIL %s\n", what);
+    ++failures;
+}
+
+static bool near(const float watts, const double expected)
+{
+    return std::abs(watts - expected) < 0.001;
+}
+
+static void write(const std::filesystem::path& path, const std::string& content)
+{
+    std::filesystem::create_directories(path.parent_path());
+    std::ofstream(path) << content << '\n';
+}
+
+static void zone(const std::filesystem::path& directory, const std::string& name, const quint64 energy)
+{
+    write(directory / "name", name);
+    write(directory / "max_energy_range_uj", std::to_string(energyRange));
+    write(directory / "energy_uj", std::to_string(energy));
+}
+
+int main()
+{
+    std::string root = (std::filesystem::temp_directory_path() / "test_power_collector.XXXXXX").string();
+    if (!mkdtemp(root.data()))
+    {
+        std::printf("FAIL can't create the fixture tree\n");
+        return 1;
+    }
+
+    const std::filesystem::path powercap = std::filesystem::path(root) / "sys/class/powercap";
+    const auto package = powercap / "intel-rapl:1";
+    const auto core    = powercap / "intel-rapl:1:0";
+    const auto dram    = powercap / "intel-rapl:1:1";
+
+    // The package wraps between the second and third tick, dram can't be read
+    zone(package, "package-1", energyRange - 45000000);
+    zone(core, "core", 1000);
+    zone(dram, "dram", 0);
+    std::filesystem::remove(dram / "energy_uj");
+    std::filesystem::create_directory(dram / "energy_uj");
+
+    SourceRegistry sources(QString::fromStdString(root));
+    PowerCollector collector(sources);
+
+    // Physical ids may be sparse, package 1 is the only cpu in data here
+    const Packages_t packages { { 1, 0 } };
+
+    Data_Cpu data;
+    data.cpus.resize(1);
+
+    qint64 now = 1000000;
+    collector.collect(data, packages, 1, now);
+
+    expect(data.cpus[0].draw == 0, "first tick is a baseline");
+    expect(data.cpus[0].domains.size() == 2, "domains are named before they are read");
+    expect(data.cpus[0].domains[1].name == "dram", "dram domain");
+
+    // 15 W and 9.5 W over two seconds
+    write(package / "energy_uj", std::to_string(energyRange - 15000000));
+    write(core / "energy_uj", std::to_string(1000 + 19000000));
+    collector.collect(data, packages, 1, now += tickUs);
+
+    expect(near(data.cpus[0].draw, 15), "package watts");
+    expect(near(data.cpus[0].domains[0].draw, 9.5), "core watts");
+    expect(data.cpus[0].domains[1].draw == 0, "unreadable dram reports 0");
+
+    // The package counter passes max_energy_range_uj
+    write(package / "energy_uj", std::to_string(15000000));
+    write(core / "energy_uj", std::to_string(1000 + 2 * 19000000));
+    collector.collect(data, packages, 1, now += tickUs);
+
+    expect(near(data.cpus[0].draw, 15), "package watts across the wrap");
+    expect(near(data.cpus[0].domains[0].draw, 9.5), "core watts next to the wrap");
+
+    // A counter that turns unreadable drops its stale draw
+    write(core / "energy_uj", "");
+    write(package / "energy_uj", std::to_string(45000000));
+    collector.collect(data, packages, 1, now += tickUs);
+
+    expect(near(data.cpus[0].draw, 15), "package watts after the wrap");
+    expect(data.cpus[0].domains[0].draw == 0, "core turned unreadable reports 0");
+
+    // A counter the kernel keeps to root, as recent ones do. Root opens it
+    // regardless, there is nothing to check then.
+    if (geteuid() != 0)
+    {
+        std::filesystem::permissions(core / "energy_uj", std::filesystem::perms::none);
+
+        SourceRegistry deniedSources(QString::fromStdString(root));
+        PowerCollector denied(deniedSources);
+
+        Data_Cpu deniedData;
+        deniedData.cpus.resize(1);
+
+        denied.collect(deniedData, packages, 1, now);
+        write(package / "energy_uj", std::to_string(45000000 + 30000000));
+        denied.collect(deniedData, packages, 1, now += tickUs);
+
+        expect(deniedData.cpus[0].domains.size() == 2, "a denied domain is still named");
+        expect(deniedData.cpus[0].domains[0].draw == 0, "denied core reports 0");
+        expect(near(deniedData.cpus[0].draw, 15), "package watts next to a denied counter");
+    }
+    else
+        std::printf("SKIP denied counter, running as root\n");
+
+    std::filesystem::remove_all(root);
+
+    if (failures == 0)
+        std::printf("All checks passed\n");
+
+    return failures == 0 ? 0 : 1;
+}
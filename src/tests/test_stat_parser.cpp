@@ -0,0 +1,78 @@
+// Checks parseProcStat against well formed and malformed /proc/stat content.
+// Malformed lines must neither hang nor shift the values around them.
+// Usage: test_stat_parser
+
+#include <cstdio>
+#include <string>
+
+#include "../collection/proc_stat_parser.h"
+
+static int failures = 0;
+
+static void expect(const bool condition, const char* what)
+{
+    if (condition) return;
+
+    std::printf("FAIL %s\n", what);
+    ++failures;
+}
+
+static Data_Cpu parse(const std::string& raw)
+{
+    Data_Cpu data;
+    auto& cpu = data.cpus.emplace_back();
+    cpu.cores.resize(2);
+
+    const Mappings_t mappings { { 0, { 0, 0 } }, { 1, { 0, 1 } } };
+    parseProcStat(QByteArrayView(raw.data(), static_cast<qsizetype>(raw.size())), data, mappings);
+
+    return data;
+}
+
+int main()
+{
+    {
+        const Data_Cpu data = parse("cpu  10 20 30 40 50 60 70 80 90 100\n"
+                                    "cpu0 1 2 3 4 5 6 7 8 9 10\n"
+                                    "cpu1 11 12 13 14\n"
+                                    "intr 100 1 2 3\n"
+                                    "ctxt 42\n"
+                                    "softirq 7 8 9\n");
+
+        expect(data.globalStats.totalCpuStats.guest_nice == 100, "total cpu columns");
+        expect(data.cpus[0].cores[0].stats.idle == 4, "cpu0 idle");
+        expect(data.cpus[0].cores[1].stats.idle == 14, "cpu1 idle");
+        expect(data.cpus[0].cores[1].stats.iowait == 0, "missing columns stay 0");
+        expect(data.globalStats.interrupts == QVector<quint64> { 100, 1, 2, 3 }, "intr");
+        expect(data.globalStats.contextSwitches == 42, "ctxt");
+        expect(data.globalStats.softIrqs == QVector<quint64> { 7, 8, 9 }, "softirq");
+    }
+
+    {
+        // CRLF line ends, negative and stray words, a key without value
+        const Data_Cpu data = parse("cpu0 1 2 3 4\r\n"
+                                    "intr 100 -1 x 5y 2\r\n"
+                                    "softirq 7 garbage 8 -\n"
+                                    "ctxt\n"
+                                    "btime 1760000000\n");
+
+        expect(data.cpus[0].cores[0].stats.idle == 4, "cpu0 with CRLF");
+        expect(data.globalStats.interrupts == QVector<quint64> { 100, 0, 0, 0, 2 }, "intr keeps positions of malformed tokens");
+        expect(data.globalStats.softIrqs == QVector<quint64> { 7, 0, 8, 0 }, "softirq keeps positions of malformed tokens");
+        expect(data.globalStats.contextSwitches == 0, "ctxt without value");
+        expect(data.globalStats.bootTime == 1760000000, "line after a malformed one");
+    }
+
+    {
+        // A cpu line with a word in between stops at it
+        const Data_Cpu data = parse("cpu1 5 6 oops 8\n");
+
+        expect(data.cpus[0].cores[1].stats.nice == 6, "cpu1 before the word");
+        expect(data.cpus[0].cores[1].stats.system == 0, "cpu1 after the word");
+    }
+
+    if (failures == 0)
+        std::printf("All checks passed\n");
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <qbytearray.h>
+#include <qfile.h>
+#include <qstring.h>
+#include <qtenvironmentvariables.h>
+
+// Prefix for every procfs/sysfs path. Lets the collectors and the brightness
+// controller run against a recorded fixture tree instead of the live machine.
+// Taken from HARDWARE_CONTROLS_ROOT, empty (the real root) by default.
+inline QString defaultFsRoot()
+{
+    return qEnvironmentVariable("HARDWARE_CONTROLS_ROOT");
+}
+
+// Trimmed content of a small procfs/sysfs attribute, empty if unreadable.
+// For discovery, files read every tick belong in a SourceRegistry.
+inline QByteArray readFsAttribute(const QString& path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return {};
+
+    return file.readAll().trimmed();
+}
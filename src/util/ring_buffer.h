@@ -0,0 +1,101 @@
+#pragma once
+
+#include <qtypes.h>
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+// Fixed capacity circular buffer. Storage is allocated once, so appending is
+// O(1) and element addresses stay stable until the capacity changes. Once
+// full, every push overwrites the oldest element.
+template<class T>
+class RingBuffer
+{
+public:
+    explicit RingBuffer(const qsizetype capacity = 1)
+    : _slots(std::max<qsizetype>(capacity, 1))
+    {}
+
+    [[nodiscard]] qsizetype size()     const { return _size; }
+    [[nodiscard]] qsizetype capacity() const { return static_cast<qsizetype>(_slots.size()); }
+    [[nodiscard]] bool      empty()    const { return _size == 0; }
+    [[nodiscard]] bool      full()     const { return _size == capacity(); }
+
+    // 0 is the oldest element
+    [[nodiscard]] const T& at(const qsizetype index) const
+    {
+        if (index < 0 || index >= _size)
+            throw std::out_of_range("Index out of bounds.");
+
+        return _slots[wrap(_head + index)];
+    }
+
+    [[nodiscard]] const T& last() const
+    {
+        return at(_size - 1);
+    }
+
+    // Position of the element at index in storage. Lets parallel arrays share
+    // the layout of this ring, setCapacity() moves the kept elements to the
+    // front in order.
+    [[nodiscard]] qsizetype slotOf(const qsizetype index) const
+    {
+        return wrap(_head + index);
+    }
+
+    // Returns the slot the value was stored in
+    const T& push(const T& value)
+    {
+        qsizetype slot;
+
+        if (_size < capacity())
+        {
+            slot = wrap(_head + _size);
+            ++_size;
+        }
+        else
+        {
+            slot  = _head;
+            _head = wrap(_head + 1);
+        }
+
+        _slots[slot] = value;
+        return _slots[slot];
+    }
+
+    // Keeps the newest elements that still fit, invalidates element addresses
+    void setCapacity(qsizetype capacity)
+    {
+        capacity = std::max<qsizetype>(capacity, 1);
+        if (capacity == this->capacity()) return;
+
+        const qsizetype kept = std::min(_size, capacity);
+
+        std::vector<T> slots(capacity);
+        for (qsizetype i = 0; i < kept; ++i)
+            slots[i] = std::move(_slots[wrap(_head + _size - kept + i)]);
+
+        _slots = std::move(slots);
+        _head  = 0;
+        _size  = kept;
+    }
+
+    void clear()
+    {
+        _head = 0;
+        _size = 0;
+    }
+
+private:
+    std::vector<T> _slots;
+
+    qsizetype _head = 0; // index of the oldest element
+    qsizetype _size = 0;
+
+    [[nodiscard]] qsizetype wrap(const qsizetype index) const
+    {
+        return index >= capacity() ? index - capacity() : index;
+    }
+};
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+// Lock-free single producer / single consumer handoff. The producer fills
+// back() and publishes it, the consumer picks up the newest published value
+// with update(). Neither side ever waits, both only swap slot indices.
+template<class T>
+class TripleBuffer
+{
+public:
+    //# Producer side
+    T& back()
+    {
+        return _slots[_back];
+    }
+
+    void publish()
+    {
+        const auto previous = _middle.exchange(_back | dirtyBit, std::memory_order_acq_rel);
+        _back = previous & indexMask;
+    }
+
+    //# Consumer side
+
+    // Returns true if a new value was published since the last call
+    bool update()
+    {
+        if (!(_middle.load(std::memory_order_relaxed) & dirtyBit))
+            return false;
+
+        const auto previous = _middle.exchange(_front, std::memory_order_acq_rel);
+        _front = previous & indexMask;
+        return true;
+    }
+
+    [[nodiscard]] const T& front() const
+    {
+        return _slots[_front];
+    }
+
+private:
+    static constexpr std::uint8_t indexMask = 0b011;
+    static constexpr std::uint8_t dirtyBit  = 0b100;
+
+    std::array<T, 3> _slots {};
+
+    std::uint8_t _back  = 0; // only touched by the producer
+    std::uint8_t _front = 1; // only touched by the consumer
+
+    std::atomic<std::uint8_t> _middle { 2 };
+};